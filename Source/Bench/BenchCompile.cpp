@@ -0,0 +1,231 @@
+// Copyright Chris Sixsmith 2020.
+
+// Compiler benchmark.
+// Builds synthetic graphs without a window and times emitting them, so changes to the emitter show up as numbers.
+// Usage: bench_compile [--scale N] [--repeat N] [--threads N]
+
+#include "Libs.h"
+#include "GraphGenerators.h"
+
+#include "Module/Module.h"
+#include "Module/Function.h"
+#include "Compiler/CompileService.h"
+#include "Compiler/EmitSink.h"
+#include "Compiler/JobPool.h"
+
+#include <atomic>
+#include <chrono>
+
+// Every allocation in the process goes through here, so each benchmark can report how many it caused.
+static atomic<size_t> AllocationCount(0);
+
+void* operator new(size_t Size)
+{
+	AllocationCount++;
+
+	if (void* Memory = malloc(Size > 0 ? Size : 1))
+	{
+		return Memory;
+	}
+
+	throw bad_alloc();
+}
+
+void operator delete(void* Memory) noexcept
+{
+	free(Memory);
+}
+
+void operator delete(void* Memory, size_t) noexcept
+{
+	free(Memory);
+}
+
+struct BenchSettings
+{
+	int Scale = 1;
+	int Repeat = 10;
+	int Threads = JobPool::GetDefaultThreadCount();
+};
+
+/** What one benchmark measured, averaged over every run. */
+struct BenchResult
+{
+	double Seconds = 0.0;
+	size_t Bytes = 0;
+	size_t Allocations = 0;
+};
+
+/** Runs a benchmark Repeat times. The function returns how many bytes it emitted. */
+static BenchResult Measure(int Repeat, const function<size_t()>& Run)
+{
+	// One run first, so nothing that only happens the first time (i.e. growing caches) gets counted.
+	Run();
+
+	BenchResult Result;
+
+	size_t AllocationsBefore = AllocationCount;
+	chrono::steady_clock::time_point Start = chrono::steady_clock::now();
+
+	for (int i = 0; i < Repeat; i++)
+	{
+		Result.Bytes = Run();
+	}
+
+	Result.Seconds = chrono::duration<double>(chrono::steady_clock::now() - Start).count() / Repeat;
+	Result.Allocations = (AllocationCount - AllocationsBefore) / Repeat;
+
+	return Result;
+}
+
+static void PrintHeader()
+{
+	printf("%-10s %-8s %9s %10s %10s %12s %12s\n", "shape", "path", "nodes", "ms/run", "Mnodes/s", "bytes", "allocs/run");
+}
+
+static void PrintResult(const string& Shape, const string& Path, int NodeCount, const BenchResult& Result)
+{
+	printf("%-10s %-8s %9d %10.3f %10.2f %12zu %12zu\n",
+		Shape.c_str(), Path.c_str(), NodeCount,
+		Result.Seconds * 1000.0, NodeCount / Result.Seconds / 1000000.0,
+		Result.Bytes, Result.Allocations);
+}
+
+/** Emits every function in the module one after another, straight from the live graph. */
+static size_t EmitModule(const Module& Mod)
+{
+	EmitSink Output;
+	vector<CompilationProblem> Problems;
+
+	for (const shared_ptr<Function>& Func : Mod.GetFunctions())
+	{
+		Func->Emit(Output, Problems);
+		Output += "\n";
+	}
+
+	return Output.GetSize();
+}
+
+/** Does what the editor does for a full recompile: freeze, emit in parallel, cache, then join the output together. */
+static size_t CompileModule(Module& Mod, JobPool& Pool)
+{
+	// Every function has to be emitted again, as if it had just been edited.
+	for (const shared_ptr<Function>& Func : Mod.GetFunctions())
+	{
+		Func->MarkDirty();
+	}
+
+	CompileResult Result = CompileService::CompileFrozen(*Mod.Freeze(), &Pool);
+
+	for (FunctionCompileResult& FuncResult : Result.Functions)
+	{
+		if (shared_ptr<Function> Func = FuncResult.Source.lock())
+		{
+			Func->StoreEmitResult(FuncResult.Version, move(FuncResult.Code), move(FuncResult.Problems), FuncResult.Pass);
+		}
+	}
+
+	EmitSink Output;
+	vector<CompilationProblem> Problems;
+
+	for (const shared_ptr<Function>& Func : Mod.GetFunctions())
+	{
+		Func->EmitCached(Output, Problems);
+		Output += "\n";
+	}
+
+	return Output.GetSize();
+}
+
+/** Builds a module with the generator, then benchmarks both compile paths on it. */
+static void RunShape(const string& Shape, const BenchSettings& Settings, JobPool& Pool, const function<int(Module& Mod)>& Generate)
+{
+	Module Mod(nullptr, Shape);
+	int NodeCount = Generate(Mod);
+
+	PrintResult(Shape, "emit", NodeCount, Measure(Settings.Repeat, [&Mod]() { return EmitModule(Mod); }));
+	PrintResult(Shape, "compile", NodeCount, Measure(Settings.Repeat, [&Mod, &Pool]() { return CompileModule(Mod, Pool); }));
+}
+
+int main(int argc, char* argv[])
+{
+	BenchSettings Settings;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		string Option = argv[i];
+		int Value = atoi(argv[i + 1]);
+
+		if (Option == "--scale")
+		{
+			Settings.Scale = max(1, Value);
+		}
+		else if (Option == "--repeat")
+		{
+			Settings.Repeat = max(1, Value);
+		}
+		else if (Option == "--threads")
+		{
+			Settings.Threads = max(0, Value);
+		}
+		else
+		{
+			printf("Unknown option %s\n", Option.c_str());
+			return 1;
+		}
+	}
+
+	JobPool Pool(Settings.Threads);
+	int Scale = Settings.Scale;
+
+	printf("scale %d, %d runs each, %d emit threads\n\n", Scale, Settings.Repeat, Pool.GetThreadCount());
+	PrintHeader();
+
+	// Emitting is recursive, so chains are kept short enough not to run out of stack.
+	RunShape("chain", Settings, Pool, [Scale](Module& Mod)
+	{
+		return GenerateChain(*Mod.CreateOrGetFunction("chain", 1), 2000 * Scale);
+	});
+
+	RunShape("fanin", Settings, Pool, [Scale](Module& Mod)
+	{
+		int Depth = 14;
+
+		for (int i = Scale; i > 1; i /= 2)
+		{
+			Depth++;
+		}
+
+		return GenerateFanIn(*Mod.CreateOrGetFunction("fanin", 1), Depth);
+	});
+
+	// Folding on its own: the same tree as above with nothing but terms in it, which comes out as one integer.
+	RunShape("constfold", Settings, Pool, [Scale](Module& Mod)
+	{
+		int Depth = 14;
+
+		for (int i = Scale; i > 1; i /= 2)
+		{
+			Depth++;
+		}
+
+		return GenerateConstantFanIn(*Mod.CreateOrGetFunction("constfold", 0), Depth);
+	});
+
+	RunShape("diamonds", Settings, Pool, [Scale](Module& Mod)
+	{
+		return GenerateDiamonds(*Mod.CreateOrGetFunction("diamonds", 1), 2000 * Scale);
+	});
+
+	RunShape("clauses", Settings, Pool, [Scale](Module& Mod)
+	{
+		return GenerateClauses(*Mod.CreateOrGetFunction("clauses", 1), 2000 * Scale);
+	});
+
+	RunShape("callweb", Settings, Pool, [Scale](Module& Mod)
+	{
+		return GenerateCallWeb(Mod, 500 * Scale, 8);
+	});
+
+	return 0;
+}
@@ -0,0 +1,238 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "GraphGenerators.h"
+
+#include "Module/Module.h"
+#include "Module/Function.h"
+#include "Nodes/Special/Node_Root.h"
+#include "Nodes/Special/Node_Term.h"
+#include "Nodes/Special/Node_UserDefined.h"
+#include "Nodes/Special/Node_Variable.h"
+#include "Nodes/Basic/Node_Operator.h"
+
+typedef Node_BinaryOperator<BinaryOperatorTraits_Add> Node_Add;
+typedef Node_BinaryOperator<BinaryOperatorTraits_Equal> Node_Equal;
+
+GraphBuilder::GraphBuilder(Function& FuncIn)
+	: Func(FuncIn)
+{}
+
+shared_ptr<Node_Root> GraphBuilder::AddRoot()
+{
+	shared_ptr<Node_Root> Root = MakeNode<Node_Root>(GetNodePool());
+
+	Func.PlaceNode(Root, Point(NextRootX, 0));
+	NextRootX++;
+	NodeCount++;
+
+	return Root;
+}
+
+const shared_ptr<NodePool>& GraphBuilder::GetNodePool() const
+{
+	return Func.GetNodePool();
+}
+
+void GraphBuilder::Place(const shared_ptr<Node>& NewNode)
+{
+	Func.PlaceNode(NewNode, Point(NextCell % RowLength, 1 + NextCell / RowLength));
+	NextCell++;
+	NodeCount++;
+}
+
+/** Adds a term node holding the given value. */
+static shared_ptr<Node> AddTerm(GraphBuilder& Builder, int Value)
+{
+	shared_ptr<Node_Term_Int> Term = Builder.Add<Node_Term_Int>();
+	Term->SetValue(Value);
+
+	return Term;
+}
+
+/** Adds a variable node for the function's argument. */
+static shared_ptr<Node> AddArgument(GraphBuilder& Builder)
+{
+	shared_ptr<Node_Variable> Variable = Builder.Add<Node_Variable>();
+	Variable->SetName("X");
+
+	return Variable;
+}
+
+/** Adds a clause that binds the function's argument to X, so the graph under it can use it. */
+static shared_ptr<Node_Root> AddClause(GraphBuilder& Builder)
+{
+	shared_ptr<Node_Root> Root = Builder.AddRoot();
+	Root->SetConnector(AddArgument(Builder).get(), 2);
+
+	return Root;
+}
+
+/** Adds a leaf for the Index'th place in a generated graph: the argument and terms take turns, so no two leaves next to each other can be folded. */
+static shared_ptr<Node> AddLeaf(GraphBuilder& Builder, int Index)
+{
+	return Index % 2 == 0 ? AddArgument(Builder) : AddTerm(Builder, Index + 1);
+}
+
+/** Adds an addition of two existing nodes. */
+static shared_ptr<Node> AddSum(GraphBuilder& Builder, const shared_ptr<Node>& LHS, const shared_ptr<Node>& RHS)
+{
+	shared_ptr<Node_Add> Sum = Builder.Add<Node_Add>();
+	Sum->SetConnector(LHS.get(), 0);
+	Sum->SetConnector(RHS.get(), 1);
+
+	return Sum;
+}
+
+/** Adds a balanced tree of additions over the given leaves, and returns its top. */
+static shared_ptr<Node> AddSumTree(GraphBuilder& Builder, vector<shared_ptr<Node>> Level)
+{
+	while (Level.size() > 1)
+	{
+		vector<shared_ptr<Node>> NextLevel;
+
+		for (size_t i = 0; i + 1 < Level.size(); i += 2)
+		{
+			NextLevel.push_back(AddSum(Builder, Level[i], Level[i + 1]));
+		}
+
+		// An odd one out goes up a level as it is.
+		if (Level.size() % 2 == 1)
+		{
+			NextLevel.push_back(Level.back());
+		}
+
+		Level = move(NextLevel);
+	}
+
+	return Level.empty() ? nullptr : Level[0];
+}
+
+int GenerateChain(Function& Func, int Length)
+{
+	assert(Func.GetArity() == 1);
+
+	GraphBuilder Builder(Func);
+
+	shared_ptr<Node_Root> Root = AddClause(Builder);
+	shared_ptr<Node> Last = AddArgument(Builder);
+
+	for (int i = 0; i < Length; i++)
+	{
+		Last = AddSum(Builder, Last, AddLeaf(Builder, i + 1));
+	}
+
+	Root->SetConnector(Last.get(), 0);
+
+	return Builder.GetNodeCount();
+}
+
+int GenerateFanIn(Function& Func, int Depth)
+{
+	assert(Func.GetArity() == 1);
+
+	GraphBuilder Builder(Func);
+
+	shared_ptr<Node_Root> Root = AddClause(Builder);
+
+	vector<shared_ptr<Node>> Leaves;
+
+	for (int i = 0; i < (1 << Depth); i++)
+	{
+		Leaves.push_back(AddLeaf(Builder, i));
+	}
+
+	Root->SetConnector(AddSumTree(Builder, move(Leaves)).get(), 0);
+
+	return Builder.GetNodeCount();
+}
+
+int GenerateConstantFanIn(Function& Func, int Depth)
+{
+	GraphBuilder Builder(Func);
+
+	shared_ptr<Node_Root> Root = Builder.AddRoot();
+
+	vector<shared_ptr<Node>> Leaves;
+
+	for (int i = 0; i < (1 << Depth); i++)
+	{
+		Leaves.push_back(AddTerm(Builder, i));
+	}
+
+	Root->SetConnector(AddSumTree(Builder, move(Leaves)).get(), 0);
+
+	return Builder.GetNodeCount();
+}
+
+int GenerateDiamonds(Function& Func, int Depth)
+{
+	assert(Func.GetArity() == 1);
+
+	GraphBuilder Builder(Func);
+
+	shared_ptr<Node_Root> Root = AddClause(Builder);
+	shared_ptr<Node> Last = AddArgument(Builder);
+
+	for (int i = 0; i < Depth; i++)
+	{
+		Last = AddSum(Builder, Last, Last);
+	}
+
+	Root->SetConnector(Last.get(), 0);
+
+	return Builder.GetNodeCount();
+}
+
+int GenerateClauses(Function& Func, int ClauseCount)
+{
+	assert(Func.GetArity() == 1);
+
+	GraphBuilder Builder(Func);
+
+	for (int i = 0; i < ClauseCount; i++)
+	{
+		shared_ptr<Node_Root> Root = AddClause(Builder);
+
+		// f(X) when X == i -> X + i + 1.
+		shared_ptr<Node_Equal> Guard = Builder.Add<Node_Equal>();
+		Guard->SetConnector(AddArgument(Builder).get(), 0);
+		Guard->SetConnector(AddTerm(Builder, i).get(), 1);
+
+		Root->SetConnector(Guard.get(), 1);
+		Root->SetConnector(AddSum(Builder, AddArgument(Builder), AddTerm(Builder, i + 1)).get(), 0);
+	}
+
+	return Builder.GetNodeCount();
+}
+
+int GenerateCallWeb(Module& Mod, int FunctionCount, int CallsPerFunction)
+{
+	vector<shared_ptr<Function>> Functions;
+
+	for (int i = 0; i < FunctionCount; i++)
+	{
+		Functions.push_back(Mod.CreateOrGetFunction("web" + to_string(i), 0));
+	}
+
+	int NodeCount = 0;
+
+	for (int i = 0; i < FunctionCount; i++)
+	{
+		GraphBuilder Builder(*Functions[i]);
+
+		shared_ptr<Node_Root> Root = Builder.AddRoot();
+
+		vector<shared_ptr<Node>> Calls;
+
+		for (int j = 1; j <= CallsPerFunction; j++)
+		{
+			Calls.push_back(Builder.Add<Node_UserDefined>(Functions[(i + j) % FunctionCount]));
+		}
+
+		Root->SetConnector(AddSumTree(Builder, move(Calls)).get(), 0);
+
+		NodeCount += Builder.GetNodeCount();
+	}
+
+	return NodeCount;
+}
@@ -0,0 +1,81 @@
+// Copyright Chris Sixsmith 2020.
+
+#pragma once
+
+#include "Libs.h"
+#include "2DPositioning.h"
+#include "Nodes/NodePool.h"
+
+class Module;
+class Function;
+class Node;
+class Node_Root;
+
+/**
+ * Graph builder.
+ * Places generated nodes into a function without anyone having to pick grid positions.
+ * - Root nodes go along the top row, left to right, so clauses come out in the order they were added.
+ * - Everything else fills the rows underneath.
+ */
+class GraphBuilder
+{
+public:
+	explicit GraphBuilder(Function& FuncIn);
+
+	/** Creates a node and places it in the next free cell. */
+	template<typename NodeType, typename... ArgTypes>
+	shared_ptr<NodeType> Add(ArgTypes&&... Args)
+	{
+		shared_ptr<NodeType> NewNode = MakeNode<NodeType>(GetNodePool(), forward<ArgTypes>(Args)...);
+		Place(NewNode);
+
+		return NewNode;
+	}
+
+	/** Creates a root node (a new clause) to the right of the existing ones. */
+	shared_ptr<Node_Root> AddRoot();
+
+	/** Returns how many nodes have been placed. */
+	int GetNodeCount() const { return NodeCount; }
+
+private:
+	/** Returns the pool of the function being built. */
+	const shared_ptr<NodePool>& GetNodePool() const;
+
+	/** Places a node in the next free cell below the roots. */
+	void Place(const shared_ptr<Node>& NewNode);
+
+private:
+	static constexpr int RowLength = 1024;
+
+	Function& Func;
+
+	int NodeCount = 0;
+	int NextCell = 0;
+	int NextRootX = 0;
+};
+
+/**
+ * Synthetic graph shapes for benchmarking the compiler.
+ * Each one fills an empty function (or module) and returns how many nodes it created.
+ * - Most shapes need a function with an arity of 1. Its argument is bound to X and used all through the graph, so constant folding can't collapse it and the emitter does the work.
+ * - GenerateConstantFanIn is made of terms only, for measuring the folding itself.
+ */
+
+/** One clause returning a chain of Length additions, each adding X or a new term to the one before. */
+int GenerateChain(Function& Func, int Length);
+
+/** One clause returning a balanced tree of additions, Depth levels deep, with X and terms taking turns at the leaves. */
+int GenerateFanIn(Function& Func, int Depth);
+
+/** One clause returning a balanced tree of additions, Depth levels deep, with a term at every leaf. The whole tree folds down to one integer. */
+int GenerateConstantFanIn(Function& Func, int Depth);
+
+/** One clause returning Depth diamonds in a row, starting from X, each addition using the one before it twice. */
+int GenerateDiamonds(Function& Func, int Depth);
+
+/** ClauseCount clauses, each guarded on X being a different integer. */
+int GenerateClauses(Function& Func, int ClauseCount);
+
+/** FunctionCount new functions, each adding up calls to the next CallsPerFunction functions around the module. */
+int GenerateCallWeb(Module& Mod, int FunctionCount, int CallsPerFunction);
@@ -69,10 +69,12 @@ struct Point
 		return Out;
 	}
 
+#if !IS_HEADLESS
 	bool IsInRectangle(const SDL_Rect& Rect) const
 	{
 		return X >= Rect.x && Y >= Rect.y && X < Rect.x + Rect.w && Y < Rect.y + Rect.h;
 	}
+#endif
 	
 	IMPLEMENT_POINT_ARITHMETIC(+);
 	IMPLEMENT_POINT_ARITHMETIC(-);
@@ -88,9 +90,17 @@ namespace std
     {
         std::size_t operator()(Point const& ToHash) const noexcept
         {
-            std::size_t h1 = std::hash<int>{}(ToHash.X);
-            std::size_t h2 = std::hash<int>{}(ToHash.Y);
-            return h1 ^ (h2 << 1);
+            // Pack both coordinates into one 64 bit key and mix it (the MurmurHash3 finaliser), so every bit of X and Y affects every bit of the hash.
+            // Just combining the two ints collides all over the place on diagonal and grid-aligned layouts, which is what node graphs look like.
+            uint64_t Key = ((uint64_t)(uint32_t)ToHash.X << 32) | (uint32_t)ToHash.Y;
+
+            Key ^= Key >> 33;
+            Key *= 0xff51afd7ed558ccdULL;
+            Key ^= Key >> 33;
+            Key *= 0xc4ceb9fe1a85ec53ULL;
+            Key ^= Key >> 33;
+
+            return (std::size_t)Key;
         }
     };
 }
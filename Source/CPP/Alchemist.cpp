@@ -3,22 +3,12 @@
 #include "Alchemist.h"
 
 #include "DrawShapes.h"
+#include "Serialiser.h"
 #include "Module/Function.h"
 
 #include "Nodes/Special/Node_Root.h"
 #include "Resources/Resource_Font.h"
 
-int main(int argc, char* argv[])
-{
-	printf("Log statements work\n");
-	
-	Alchemist AlchemistInstance = Alchemist();
-
-	AlchemistInstance.Run();
-
-	return 0;
-}
-
 #if IS_WEB
 EM_JS(int, GetWindowWidthJS, (), {
 	return document.getElementById("canvas").width;
@@ -28,8 +18,25 @@ EM_JS(int, GetWindowHeightJS, (), {
 	return document.getElementById("canvas").height; 
 });
 
-EM_JS(void, EmitText, (const char* Text, int TextLen), {
-	return document.getElementById("output").value = UTF8ToString(Text, TextLen);
+EM_JS(void, BeginEmitText, (), {
+	Module.EmitTextChunks = [];
+});
+
+EM_JS(void, EmitTextChunk, (const char* Text, int TextLen), {
+	Module.EmitTextChunks.push(HEAPU8.slice(Text, Text + TextLen));
+});
+
+EM_JS(void, EndEmitText, (), {
+	// Chunks can split a UTF-8 character, so they're only decoded once they're all joined back up.
+	var Length = 0;
+	Module.EmitTextChunks.forEach(function(Chunk) { Length += Chunk.length; });
+
+	var Bytes = new Uint8Array(Length);
+	var Offset = 0;
+	Module.EmitTextChunks.forEach(function(Chunk) { Bytes.set(Chunk, Offset); Offset += Chunk.length; });
+
+	Module.EmitTextChunks = [];
+	document.getElementById("output").value = new TextDecoder("utf-8").decode(Bytes);
 });
 
 void LoopCallback(void* Arg)
@@ -49,10 +56,16 @@ EM_BOOL UiEventCallback(int Type, const EmscriptenUiEvent* UiEvent, void* UserDa
 
 
 Alchemist::Alchemist()
-	: CurrentModule(this), Nodes(this)
+	: Nodes(&CurrentModule), CurrentModule(this)
 {
 	// Initialize SDL
 	assert(SDL_Init(SDL_INIT_VIDEO) == 0);
+
+#if !IS_WEB
+	// Present in step with the display. This has to be asked for before the renderer is made, and setting SDL_RENDER_VSYNC=0 in the environment turns it off.
+	SDL_SetHint(SDL_HINT_RENDER_VSYNC, "1");
+#endif
+
 	assert(SDL_CreateWindowAndRenderer(GetWindowStartSize().X, GetWindowStartSize().Y, 0, &Window, &Renderer) == 0);
 
 	assert(TTF_Init() == 0);
@@ -66,12 +79,33 @@ Alchemist::Alchemist()
 	// Get window surface
 	WindowSurface = SDL_GetWindowSurface(Window);
 
+	// Wake the frame loop whenever a compile finishes. SDL_PushEvent is safe to call from the compiler's thread.
+	CompileResultEvent = SDL_RegisterEvents(1);
+	assert(CompileResultEvent != (Uint32)-1);
+
+	Compiler.SetResultCallback([EventType = CompileResultEvent]()
+	{
+		SDL_Event Event;
+		SDL_zero(Event);
+		Event.type = EventType;
+
+		SDL_PushEvent(&Event);
+	});
+
 	// Create a node
 	CurrentFunction = CurrentModule.CreateOrGetFunction("Main", 0);
+
+	ProjectPath = CurrentModule.GetName() + ".alch";
 }
 
 Alchemist::~Alchemist()
 {
+	// The compiler outlives SDL, so it mustn't push any more events.
+	Compiler.SetResultCallback(nullptr);
+
+	// The layers' textures go with the renderer.
+	ReleaseLayers();
+
 	// Destroy window
 	SDL_DestroyWindow(Window);
 
@@ -84,39 +118,115 @@ void Alchemist::Run()
 #if !IS_WEB
 	while(!Close)
 	{
+		if (NeedsRedraw)
+		{
+			// Something is waiting to be drawn - draw it as soon as the frame cap allows.
+			Uint32 Wait = GetTimeUntilNextFrame();
+
+			if (Wait > 0)
+			{
+				SDL_Delay(Wait);
+			}
+		}
+		else
+		{
+			// Nothing to draw, so sleep until something happens (input, the window changing, or a compile finishing).
+			SDL_WaitEvent(nullptr);
+		}
+
 		Frame();
-		SDL_Delay(16);
 	}
 #else
 	emscripten_set_resize_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW, this, true, UiEventCallback);
-	emscripten_set_main_loop_arg(&LoopCallback, this, 60, 1);
+
+	// Run on requestAnimationFrame. Frames with nothing new skip drawing and leave the canvas as it is.
+	emscripten_set_main_loop_arg(&LoopCallback, this, 0, 1);
 #endif
 }
 
 void Alchemist::Compile()
 {
-	string OutCode;
-	vector<CompilationProblem> OutProblems;
+	// Skip the run entirely if nothing changed since last time.
+	if (CurrentModule.GetVersion() == LastCompiledModuleVersion)
+	{
+		return;
+	}
+
+	// Only one frozen module is compiled at a time. Freezing copies every function edited since the last freeze, so edits made while the compiler is busy
+	// are left to pile up and go in the next one together - a burst of typing costs one copy of the function rather than one per key.
+	if (Compiler.IsBusy())
+	{
+		return;
+	}
 
-	string OutPrint = "--- COMPILE RESULT ---\n\n";
+	// Functions that haven't changed reuse the code they emitted last time, and their frozen copies from the last freeze.
+	// The freeze itself is done here, on the UI thread, and isn't free: a frame that compiles pays for a whole copy of each edited function.
+	// For one big function that can be longer than a frame, so editing it doesn't stay at frame rate - only emitting it is moved off this thread.
+	// Freezing can mark callers of a renamed function dirty, so the version is read back from it.
+	shared_ptr<const FrozenModule> Frozen = CurrentModule.Freeze();
+	LastCompiledModuleVersion = Frozen->ModuleVersion;
 
+	Compiler.Submit(Frozen);
+}
+
+bool Alchemist::ReceiveCompileResult()
+{
+	CompileResult Result;
+
+	if (!Compiler.PollResult(Result))
+	{
+		return false;
+	}
+
+	// Cache the newly emitted functions.
+	for (FunctionCompileResult& FuncResult : Result.Functions)
+	{
+		if (shared_ptr<Function> Func = FuncResult.Source.lock())
+		{
+			Func->StoreEmitResult(FuncResult.Version, move(FuncResult.Code), move(FuncResult.Problems), FuncResult.Pass);
+		}
+	}
+
+	// Only functions that were emitted again have their problems replaced. The grid reads these every frame.
+	const vector<shared_ptr<Function>>& Functions = CurrentModule.GetFunctions();
+	CompileDiagnostics.Update(Functions);
+
+	// Work out whether the compile passed and how big the output is before writing any of it.
+	// Emitting is left to the compiler: if a function changed after it was frozen, its code isn't cached yet and the output waits for the next result.
 	bool Ok = true;
-	auto Functions = CurrentModule.GetFunctions();
-	
-	for(int i = 0; i < Functions.size(); i++)
+	size_t CodeSize = 0;
+
+	for (int i = 0; i < Functions.size(); i++)
 	{
-		if(!Functions[i]->Emit(OutCode, OutProblems))
+		if (Functions[i]->IsDirty())
+		{
+			return true;
+		}
+
+		if (!Functions[i]->GetCachedPass())
 		{
 			Ok = false;
 		}
 
-		OutCode += "\n";
+		CodeSize += Functions[i]->GetCachedCode().GetSize() + 1;
 	}
+
+	// Then write the code straight into the output.
+	EmitSink OutPrint;
+	OutPrint.Reserve(Ok ? CodeSize + 64 : 64);
+
+	OutPrint += "--- COMPILE RESULT ---\n\n";
 	
 	if (Ok)
 	{
 		// Print the code
-		OutPrint += OutCode + "\n\n";
+		for (int i = 0; i < Functions.size(); i++)
+		{
+			Functions[i]->GetCachedCode().AppendTo(OutPrint);
+			OutPrint += "\n";
+		}
+
+		OutPrint += "\n\n";
 	}
 	else
 	{
@@ -124,34 +234,34 @@ void Alchemist::Compile()
 	}
 
 	// Always print the problems
-	if (OutProblems.size() > 0)
+	if (CompileDiagnostics.GetProblemCount() > 0)
 	{
 		OutPrint += "--- PROBLEMS ---\n\n";
-
-		for (int i = 0; i < OutProblems.size(); i++)
-		{
-			// sorry god
-			Function* ProblemFunction = OutProblems[i].ProblemNode.lock()->GetFunction();
-			OutPrint += 
-				"- (In " + (ProblemFunction->GetName() + ":" + to_string(ProblemFunction->GetArity()))
-			  + " @ (" + to_string(OutProblems[i].ProblemNode.lock()->GetGridPosition().X) + ", " + to_string(OutProblems[i].ProblemNode.lock()->GetGridPosition().Y)
-			  + ")) " + OutProblems[i].Problem + "\n";
-		}
+		OutPrint += CompileDiagnostics.GetReport();
 	}
 
 #if IS_WEB
-	EmitText(OutPrint.c_str(), OutPrint.size());
+	// Hand the output over a chunk at a time, rather than joining it into one string first.
+	BeginEmitText();
+
+	OutPrint.ForEachChunk([](const char* Text, size_t TextLen)
+	{
+		EmitTextChunk(Text, (int)TextLen);
+	});
+
+	EndEmitText();
 #endif
-	
-	// Leave the problems cached - we will display them until the code is recompiled, or a different function is opened.
-	// TODO do this per function?
-	ProblemsFromLastCompile = OutProblems;
+
+	return true;
 }
 
 void Alchemist::Frame()
 {
 	assert(CurrentFunction);
 
+	// Nothing from the last frame is needed anymore.
+	Arena.Reset();
+
 
 	/////////////////////////////////////////////////////////////////
 	/////////////////////////////////////////////////////////////////
@@ -163,34 +273,84 @@ void Alchemist::Frame()
 
 		while (SDL_PollEvent(&Event))
 		{
-			// Core events
-			switch (Event.type)
-			{
-				case SDL_QUIT:
-				{
-					Close = true;
-					break;
-				}
-			}
-			
-			if (!ToolbarHandleEvent(Event))
-			{
-				if (!PaletteHandleEvent(Event))
-				{
-					GridHandleEvent(Event);
-				}
-			}
-
-			Compile();
+			HandleEvent(Event);
 		}
 	}
 
+	// Pick up anything the compiler has finished, then recompile whatever changed since (the events above, or edits made while it was busy).
+	if (ReceiveCompileResult())
+	{
+		// The grid shows the new problems.
+		NeedsRedraw = true;
+	}
+
+	Compile();
+
+	// Nothing has changed on screen since it was last drawn.
+	if (!NeedsRedraw)
+	{
+		return;
+	}
+
 	DrawGrid();
 	DrawNodePalette();
 	DrawToolbar();
 	
 	// Finish
 	SDL_RenderPresent(Renderer);
+
+	NeedsRedraw = false;
+	LastFrameTime = SDL_GetTicks();
+}
+
+void Alchemist::HandleEvent(SDL_Event& Event)
+{
+	// Only there to wake the loop. The result itself is collected after the events.
+	if (Event.type == CompileResultEvent)
+	{
+		return;
+	}
+
+	// Anything else can change what's on screen (even just the mouse moving changes what's highlighted).
+	NeedsRedraw = true;
+
+	// Core events
+	switch (Event.type)
+	{
+		case SDL_QUIT:
+		{
+			Close = true;
+			break;
+		}
+		case SDL_RENDER_TARGETS_RESET:
+		case SDL_RENDER_DEVICE_RESET:
+		{
+			// The layers' contents (or the textures themselves) are gone.
+			ReleaseLayers();
+			break;
+		}
+	}
+	
+	if (!ToolbarHandleEvent(Event))
+	{
+		if (!PaletteHandleEvent(Event))
+		{
+			GridHandleEvent(Event);
+		}
+	}
+}
+
+Uint32 Alchemist::GetTimeUntilNextFrame() const
+{
+	if (FrameCap <= 0)
+	{
+		return 0;
+	}
+
+	Uint32 FrameInterval = 1000 / FrameCap;
+	Uint32 SinceLastFrame = SDL_GetTicks() - LastFrameTime;
+
+	return SinceLastFrame < FrameInterval ? FrameInterval - SinceLastFrame : 0;
 }
 
 Point Alchemist::ScreenToGraph(const Point& ScreenPosition) const
@@ -255,6 +415,8 @@ Point Alchemist::GetCategoryButtonPosition(int Index) const
 EM_BOOL Alchemist::UiEvent(int Type, const EmscriptenUiEvent* UiEvent)
 {
 	SDL_SetWindowSize(Window, GetWindowWidthJS(), GetWindowHeightJS());
+	NeedsRedraw = true;
+
 	return EM_TRUE;
 }
 #endif
@@ -281,7 +443,9 @@ Size Alchemist::GetOptionsMenuOptionSize(const shared_ptr<Node>& NodeOnGrid) con
 
 	for (int i = 0; i < NodeOnGrid->GetNumArguments(); i++)
 	{
-		string Argument = to_string(i+1) + "  " + NodeOnGrid->GetArgumentName(i);
+		FrameString Argument = NewFrameString();
+		AppendInt(Argument, i+1) += "  ";
+		Argument += NodeOnGrid->GetArgumentName(i);
 
 		Size StringSize = FontResource->GetStringScreenSize(Argument);
 
@@ -314,6 +478,87 @@ void Alchemist::ViewFunction(string Name)
 void Alchemist::EditFunctionSignature()
 {
 	EditingFunctionSignature = true;
+
+	// Everything typed into the signature is undone together.
+	History.BeginGesture();
+}
+
+void Alchemist::Undo()
+{
+	// Don't pull the program out from under a drag.
+	if (NodeOnMouse || NodeBeingConnected)
+	{
+		return;
+	}
+
+	shared_ptr<Function> Func = History.Undo();
+
+	if (Func && CurrentModule.GetFunction(Func->GetName()) == Func)
+	{
+		CurrentFunction = Func;
+	}
+}
+
+void Alchemist::Redo()
+{
+	if (NodeOnMouse || NodeBeingConnected)
+	{
+		return;
+	}
+
+	shared_ptr<Function> Func = History.Redo();
+
+	if (Func && CurrentModule.GetFunction(Func->GetName()) == Func)
+	{
+		CurrentFunction = Func;
+	}
+}
+
+bool Alchemist::OpenProject(const string& Path)
+{
+	ProjectPath = Path;
+
+	if (!filesystem::exists(Path))
+	{
+		return true; // new project, it'll be created on the first save
+	}
+
+	// Nothing the editor is holding onto will be in the module once it's loaded.
+	NodeOnMouse = nullptr;
+	NodeBeingConnected = nullptr;
+	NodeBeingConnectedTo = nullptr;
+	NodeLastSelected.reset();
+	CompileDiagnostics.Clear();
+	History.Clear();
+	EditingFunctionSignature = false;
+	ToolbarOpenMenu = -1;
+
+	string Error;
+	bool Loaded = Serialiser::Load(CurrentModule, Nodes, Path, Error);
+
+	if (!Loaded)
+	{
+		printf("Couldn't load the project: %s\n", Error.c_str());
+	}
+
+	CurrentFunction = CurrentModule.CreateOrGetFunction("Main", 0);
+
+	return Loaded;
+}
+
+bool Alchemist::SaveProject() const
+{
+	string Error;
+
+	if (!Serialiser::Save(CurrentModule, ProjectPath, Error))
+	{
+		printf("Couldn't save the project: %s\n", Error.c_str());
+		return false;
+	}
+
+	printf("Saved the project to %s\n", ProjectPath.c_str());
+
+	return true;
 }
 
 Size Alchemist::GetWindowStartSize() const
@@ -326,6 +571,45 @@ Size Alchemist::GetWindowStartSize() const
 }
 
 void Alchemist::DrawToolbar() const
+{
+	const vector<ToolbarOptionData>& Options = GetToolbarOptions();
+
+	// Work out what's under the mouse, as the toolbar is only redrawn when that changes.
+	int HoveredOption = -1;
+	int HoveredSubOption = -1;
+
+	for (int i = 0; i < (int)Options.size(); i++)
+	{
+		if (MousePos.IsInRectangle(GetToolbarOptionSelectionRect(i)))
+		{
+			HoveredOption = i;
+		}
+	}
+
+	if (ToolbarOpenMenu != -1)
+	{
+		for (int i = 0; i < (int)Options[ToolbarOpenMenu].SubOptions.size(); i++)
+		{
+			if (MousePos.IsInRectangle(GetToolbarSubOptionRect(ToolbarOpenMenu, i)))
+			{
+				HoveredSubOption = i;
+			}
+		}
+	}
+
+	LayerKey Key;
+	Key.Add(CurrentModule.GetSignatureVersion()).Add((intptr_t)CurrentFunction.get()).Add(ToolbarOpenMenu).Add(HoveredOption).Add(HoveredSubOption);
+
+	if (ToolbarLayer.Begin(Renderer, GetWindowSize(), Key))
+	{
+		DrawToolbarLayer();
+		ToolbarLayer.End(Renderer);
+	}
+
+	ToolbarLayer.Draw(Renderer);
+}
+
+void Alchemist::DrawToolbarLayer() const
 {
 	shared_ptr<Resource_Font> Font = GetDefaultFont();
 	
@@ -347,20 +631,10 @@ void Alchemist::DrawToolbar() const
 	SDL_RenderFillRect(Renderer, &ToolbarRect);
 
 	// Render logo
-	Size LogoSize = Font->GetStringScreenSize("@");
-
-	SDL_Rect OptionRect = {
-		ToolbarPadding * 2,
-		ToolbarPadding,
-		LogoSize.X,
-		LogoSize.Y
-	};
-
-	SDL_SetTextureColorMod(Font->GetStringTexture("@"), 0, 0, 0);
-	SDL_RenderCopy(Renderer, Font->GetStringTexture("@"), NULL, &OptionRect);
+	Font->DrawString("@", Point(ToolbarPadding * 2, ToolbarPadding));
 	
 	// Render individual buttons
-	auto Options = GetToolbarOptions();
+	const vector<ToolbarOptionData>& Options = GetToolbarOptions();
 
 	for(int i = 0; i < (int)Options.size(); i++)
 	{
@@ -378,18 +652,10 @@ void Alchemist::DrawToolbar() const
 		}
 
 		// Text
-		string OptionName = Options[i].Option;
-		Size OptionSize = Font->GetStringScreenSize(OptionName);
-		
-		SDL_Rect OptionRect = {
-			GetToolbarOptionX(i) + ToolbarPadding,
-			ToolbarPadding,
-			OptionSize.X,
-			OptionSize.Y
-		};
+		const string& OptionName = Options[i].Option;
+		Uint8 TextColor = (Uint8)TextColorMod;
 
-		SDL_SetTextureColorMod(Font->GetStringTexture(OptionName), TextColorMod, TextColorMod, TextColorMod);
-		SDL_RenderCopy(Renderer, Font->GetStringTexture(OptionName), NULL, &OptionRect);
+		Font->DrawString(OptionName, Point(GetToolbarOptionX(i) + ToolbarPadding, ToolbarPadding), 30, SDL_Color{ TextColor, TextColor, TextColor, 255 });
 	}
 
 	// Is a menu open?
@@ -414,30 +680,67 @@ void Alchemist::DrawToolbar() const
 			SDL_RenderFillRect(Renderer, &OptionRect);
 			
 			// Draw option text
-			string OptionName = Options[ToolbarOpenMenu].SubOptions[i];
-			Size TextSize = Font->GetStringScreenSize(OptionName);
-
-			SDL_Rect TextRect = {
-				OptionRect.x + ToolbarPadding,
-				OptionRect.y + ToolbarPadding,
-				TextSize.X,
-				TextSize.Y
-			};
-			
-			SDL_SetTextureColorMod(Font->GetStringTexture(OptionName), TextColorMod, TextColorMod, TextColorMod);
-			SDL_RenderCopy(Renderer, Font->GetStringTexture(OptionName), NULL, &TextRect);
+			const string& OptionName = Options[ToolbarOpenMenu].SubOptions[i];
+			Uint8 TextColor = (Uint8)TextColorMod;
+
+			Font->DrawString(OptionName, Point(OptionRect.x + ToolbarPadding, OptionRect.y + ToolbarPadding), 30, SDL_Color{ TextColor, TextColor, TextColor, 255 });
 		}
 	}
 }
 
 void Alchemist::DrawNodePalette() const
 {
-	vector<Category> CategorisedNodes = Nodes.GetCategorisedNodes(); // todo: constantly calling this is terrible!
+	const vector<Category>& CategorisedNodes = Nodes.GetCategorisedNodes();
 	const Category& CurrentCategory = CategorisedNodes[PaletteCategory];
 
 	// Calculate the category item the mouse is currently over (null if none)
 	int PaletteSelection = GetPaletteSelection(CurrentCategory);
 
+	int HoveredCategory = -1;
+
+	for (int i = 0; i < CategorisedNodes.size(); i++)
+	{
+		Point CategoryButtonPos = GetCategoryButtonPosition(i);
+
+		SDL_Rect Rect{ CategoryButtonPos.X, CategoryButtonPos.Y, GridSize, GridSize };
+
+		if (MousePos.IsInRectangle(Rect))
+		{
+			HoveredCategory = i;
+		}
+	}
+
+	// The palette's nodes only change with the module's function signatures.
+	LayerKey Key;
+	Key.Add(CurrentModule.GetSignatureVersion()).Add(PaletteCategory).Add(PaletteSelection).Add(HoveredCategory);
+
+	if (PaletteLayer.Begin(Renderer, GetWindowSize(), Key))
+	{
+		DrawNodePaletteLayer();
+		PaletteLayer.End(Renderer);
+	}
+
+	PaletteLayer.Draw(Renderer);
+
+	// Tooltips follow the mouse, so they're drawn on top every frame.
+	if (PaletteSelection != -1)
+	{
+		DrawNodeTooltip(CurrentCategory.Nodes[PaletteSelection]);
+	}
+
+	if (HoveredCategory != -1)
+	{
+		DrawTooltip(CategorisedNodes[HoveredCategory].Name);
+	}
+}
+
+void Alchemist::DrawNodePaletteLayer() const
+{
+	const vector<Category>& CategorisedNodes = Nodes.GetCategorisedNodes();
+	const Category& CurrentCategory = CategorisedNodes[PaletteCategory];
+
+	int PaletteSelection = GetPaletteSelection(CurrentCategory);
+
 	// Render palette
 	SDL_Rect PaletteRect{ GetWindowSize().X - SidebarWidth, ToolbarHeight + (ToolbarPadding * 2), SidebarWidth, GetWindowSize().Y };
 
@@ -455,9 +758,6 @@ void Alchemist::DrawNodePalette() const
 
 			SDL_SetRenderDrawColor(Renderer, 255, 255, 255, 100);
 			SDL_RenderFillRect(Renderer, &Rect);
-
-			// Draw node name
-			DrawNodeTooltip(CurrentCategory.Nodes[i]);
 		}
 
 		CurrentCategory.Nodes[i]->Draw(this, GetPaletteItemPosition(i));
@@ -507,53 +807,39 @@ void Alchemist::DrawNodePalette() const
 	PaletteRect.y = GetCategoryButtonPosition(PaletteCategory).Y + GridSize;
 	PaletteRect.h = GetWindowSize().Y - GetCategoryButtonPosition(PaletteCategory).Y + GridSize - ToolbarHeight - (ToolbarPadding * 2);
 	SDL_RenderFillRect(Renderer, &PaletteRect);
-
-	// Tooltip?
-	for (int i = 0; i < CategorisedNodes.size(); i++)
-	{
-		Point CategoryButtonPos = GetCategoryButtonPosition(i);
-
-		SDL_Rect Rect{ CategoryButtonPos.X, CategoryButtonPos.Y, GridSize, GridSize };
-
-		if(MousePos.IsInRectangle(Rect))
-		{
-			DrawTooltip(CategorisedNodes[i].Name);
-		}
-	}
 }
 
 void Alchemist::DrawGrid() const
 {
 	shared_ptr<Resource_Font> Font = GetDefaultFont();
-	
-	// Draw background
-	SDL_SetRenderDrawColor(Renderer, 255, 255, 255, 255);
-	SDL_RenderClear(Renderer);
-
-	// Draw grid
-	SDL_SetRenderDrawColor(Renderer, 220, 220, 220, 255);
 
-	int x = -ViewTopLeft.X % GridSize;
-	int y = -ViewTopLeft.Y % GridSize;
+	// Draw background. The grid lines repeat every grid square, so the layer is drawn once a square bigger than the window and slid along under the view.
+	Point GridOffset(
+		(-ViewTopLeft.X % GridSize + GridSize) % GridSize - GridSize,
+		(-ViewTopLeft.Y % GridSize + GridSize) % GridSize - GridSize);
 
-	for (; x < GetWindowSize().X; x += GridSize)
+	if (GridLayer.Begin(Renderer, GetWindowSize() + Size(GridSize, GridSize), LayerKey()))
 	{
-		SDL_RenderDrawLine(Renderer, x, 0, x, GetWindowSize().Y);
+		DrawGridLayer(GridLayer.IsDrawingDirect() ? GridOffset : Point());
+		GridLayer.End(Renderer);
 	}
 
-	for (; y < GetWindowSize().Y; y += GridSize)
-	{
-		SDL_RenderDrawLine(Renderer, 0, y, GetWindowSize().X, y);
-	}
+	GridLayer.Draw(Renderer, GridOffset);
 
-	// If 0, 0 is on screen, draw it
+	// If 0, 0 is on screen, draw it. It moves with the view, so it goes over the layer.
 	SDL_SetRenderDrawColor(Renderer, 150, 150, 150, 255);
 
 	SDL_RenderDrawLine(Renderer, ViewTopLeft.X, -ViewTopLeft.Y, GetWindowSize().X, -ViewTopLeft.Y);
 	SDL_RenderDrawLine(Renderer, -ViewTopLeft.X, ViewTopLeft.Y, -ViewTopLeft.X, GetWindowSize().Y);
 	
+	// Only what's on screen is drawn, so big functions cost no more to draw than small ones.
+	Point ViewMin = ScreenToGrid(Point(0, 0));
+	Point ViewMax = ScreenToGrid(Point(GetWindowSize().X, GetWindowSize().Y));
+
+	shared_ptr<Node> SelectedNode = NodeLastSelected.lock();
+
 	// Draw nodes
-	for (shared_ptr<Node> NodeOnGrid : CurrentFunction->GetNodes())
+	CurrentFunction->ForEachNodeInArea(ViewMin, ViewMax, [this, &SelectedNode](const shared_ptr<Node>& NodeOnGrid)
 	{
 		Point Position = NodeOnGrid->GetGridPosition();
 
@@ -567,7 +853,7 @@ void Alchemist::DrawGrid() const
 			GridSize
 		};
 		
-		if (NodeOnGrid == NodeLastSelected.lock())
+		if (NodeOnGrid == SelectedNode)
 		{
 			// Draw selection rectangle.
 			SDL_SetRenderDrawColor(Renderer, 200, 200, 200, 255);
@@ -576,26 +862,30 @@ void Alchemist::DrawGrid() const
 
 		// Draw
 		NodeOnGrid->Draw(this, ScreenPosition, NodeOnGrid == NodeOnMouse);
-	}
+
+		// Outline nodes the last compile had a problem with.
+		if (CompileDiagnostics.HasProblem(NodeOnGrid.get()))
+		{
+			SDL_SetRenderDrawColor(Renderer, 220, 0, 0, 255);
+			SDL_RenderDrawRect(Renderer, &GridRect);
+
+			SDL_Rect InnerRect = { GridRect.x + 1, GridRect.y + 1, GridRect.w - 2, GridRect.h - 2 };
+			SDL_RenderDrawRect(Renderer, &InnerRect);
+		}
+	});
 
 	// Draw node connections
-	for (shared_ptr<Node> NodeOnGrid : CurrentFunction->GetNodes())
+	CurrentFunction->ForEachConnectorInArea(ViewMin, ViewMax, [this](const Node& Connector, const Node& NodeOnGrid, int i)
 	{
-		for (int i = 0; i < NodeOnGrid->GetNumArguments(); i++)
-		{
-			if (shared_ptr<Node> Connector = NodeOnGrid->GetConnector(i))
-			{
-				SDL_SetRenderDrawColor(Renderer, 0, 0, 0, 255);
+		SDL_SetRenderDrawColor(Renderer, 0, 0, 0, 255);
 
-				if(NodeOnGrid->GetArgumentIsPattern(i))
-				{
-					SDL_SetRenderDrawColor(Renderer, 200, 0, 200, 255);
-				}
-				
-				DrawConnectorArrowOnGrid(Connector->GetGridPosition(), NodeOnGrid->GetGridPosition(), i);
-			}
+		if(NodeOnGrid.GetArgumentIsPattern(i))
+		{
+			SDL_SetRenderDrawColor(Renderer, 200, 0, 200, 255);
 		}
-	}
+		
+		DrawConnectorArrowOnGrid(Connector.GetGridPosition(), NodeOnGrid.GetGridPosition(), i);
+	});
 
 	// Draw node being dragged
 	if (NodeOnMouse)
@@ -701,7 +991,9 @@ void Alchemist::DrawGrid() const
 			for (int i = 0; i < NodeBeingConnectedTo->GetNumArguments(); i++)
 			{
 				// For rendering string
-				string Argument = to_string(i+1) + "  " + NodeBeingConnectedTo->GetArgumentName(i);
+				FrameString Argument = NewFrameString();
+				AppendInt(Argument, i+1) += "  ";
+				Argument += NodeBeingConnectedTo->GetArgumentName(i);
 
 				Size StringSize = Font->GetStringScreenSize(Argument);
 
@@ -740,7 +1032,7 @@ void Alchemist::DrawGrid() const
 				}
 
 				// Then string
-				SDL_RenderCopy(Renderer, Font->GetStringTexture(Argument), NULL, &Rect);
+				Font->DrawString(Argument, Point(Rect.x, Rect.y), 30, SDL_Color{ 255, 255, 255, 255 });
 			}
 		}
 	}
@@ -748,36 +1040,46 @@ void Alchemist::DrawGrid() const
 	// If editing function, show edit text
 	if(EditingFunctionSignature)
 	{
-		string Text = CurrentFunction->GetName() + "_ : " + to_string(CurrentFunction->GetArity());
-		string HintText = "[ENTER] Confirm[UP / DOWN] Change Arity";
+		FrameString Text = NewFrameString();
+		Text += CurrentFunction->GetName();
+		Text += "_ : ";
+		AppendInt(Text, CurrentFunction->GetArity());
+
+		const char* HintText = "[ENTER] Confirm[UP / DOWN] Change Arity";
 
-		// Text
 		Point Position = Point(ToolbarPadding, ToolbarHeight + (ToolbarPadding * 2));
-		Size Siz = Font->GetStringScreenSize(Text);
 
-		SDL_Rect Rect = {
-			Position.X,
-			Position.Y,
-			Siz.X,
-			Siz.Y
-		};
+		Font->DrawString(Text, Position);
+		Font->DrawString(HintText, Position + Point(0, 40));
+	}
+}
 
-		SDL_SetTextureColorMod(Font->GetStringTexture(Text), 0, 0, 0);
-		SDL_RenderCopy(Renderer, Font->GetStringTexture(Text), NULL, &Rect);
+void Alchemist::DrawGridLayer(const Point& Origin) const
+{
+	SDL_SetRenderDrawColor(Renderer, 255, 255, 255, 255);
+	SDL_RenderClear(Renderer);
 
-		// HintText
-		Siz = Font->GetStringScreenSize(HintText);
+	// Draw grid
+	SDL_SetRenderDrawColor(Renderer, 220, 220, 220, 255);
 
-		Rect = {
-			Position.X,
-			Position.Y + 40,
-			Siz.X,
-			Siz.Y
-		};
+	Size LayerSize = GetWindowSize() + Size(GridSize, GridSize);
 
-		SDL_SetTextureColorMod(Font->GetStringTexture(HintText), 0, 0, 0);
-		SDL_RenderCopy(Renderer, Font->GetStringTexture(HintText), NULL, &Rect);
+	for (int x = Origin.X; x < LayerSize.X; x += GridSize)
+	{
+		SDL_RenderDrawLine(Renderer, x, 0, x, LayerSize.Y);
 	}
+
+	for (int y = Origin.Y; y < LayerSize.Y; y += GridSize)
+	{
+		SDL_RenderDrawLine(Renderer, 0, y, LayerSize.X, y);
+	}
+}
+
+void Alchemist::ReleaseLayers()
+{
+	GridLayer.Release();
+	PaletteLayer.Release();
+	ToolbarLayer.Release();
 }
 
 bool Alchemist::ToolbarHandleEvent(SDL_Event& Event)
@@ -790,7 +1092,8 @@ bool Alchemist::ToolbarHandleEvent(SDL_Event& Event)
 			
 			if(Event.button.button == 1)
 			{
-				auto Options = GetToolbarOptions();
+				// Copied, as selecting an option can change the options.
+				vector<ToolbarOptionData> Options = GetToolbarOptions();
 
 				// If the mouse is over a main toolbar option, open that toolbar menu.
 				for (int i = 0; i < (int)Options.size(); i++)
@@ -843,7 +1146,7 @@ bool Alchemist::ToolbarHandleEvent(SDL_Event& Event)
 		{
 			if (EditingFunctionSignature)
 			{
-				CurrentFunction->Rename(CurrentFunction->GetName() + Event.text.text);
+				History.Rename(CurrentFunction, CurrentFunction->GetName() + Event.text.text);
 			}
 
 			break;
@@ -854,15 +1157,15 @@ bool Alchemist::ToolbarHandleEvent(SDL_Event& Event)
 			{
 				if (Event.key.keysym.sym == SDLK_BACKSPACE)
 				{
-					CurrentFunction->Rename(CurrentFunction->GetName().substr(0, CurrentFunction->GetName().size() - 1));
+					History.Rename(CurrentFunction, CurrentFunction->GetName().substr(0, CurrentFunction->GetName().size() - 1));
 				}
 				else if (Event.key.keysym.sym == SDLK_UP)
 				{
-					CurrentFunction->SetArity(CurrentFunction->GetArity() + 1);
+					History.SetArity(CurrentFunction, CurrentFunction->GetArity() + 1);
 				}
 				else if (Event.key.keysym.sym == SDLK_DOWN)
 				{
-					CurrentFunction->SetArity(CurrentFunction->GetArity() > 0 ? CurrentFunction->GetArity() - 1 : 0);
+					History.SetArity(CurrentFunction, CurrentFunction->GetArity() > 0 ? CurrentFunction->GetArity() - 1 : 0);
 				}
 				else if (Event.key.keysym.sym == SDLK_RETURN)
 				{
@@ -890,15 +1193,18 @@ bool Alchemist::PaletteHandleEvent(SDL_Event& Event)
 		{
 			if (Event.motion.x > GetWindowSize().X - SidebarWidth - GridSize)
 			{
+				// Dropping what we pick up here is part of the same edit.
+				History.BeginGesture();
+
 				// Pick up the palette selection.
-				vector<Category> CategorisedNodes = Nodes.GetCategorisedNodes(); // todo: constantly calling this is terrible!
+				const vector<Category>& CategorisedNodes = Nodes.GetCategorisedNodes();
 				const Category& CurrentCategory = CategorisedNodes[PaletteCategory];
 
 				int PaletteSelection = GetPaletteSelection(CurrentCategory);
 
 				if (PaletteSelection != -1)
 				{
-					NodeOnMouse = CurrentCategory.Nodes[PaletteSelection]->Clone();
+					NodeOnMouse = CurrentCategory.Nodes[PaletteSelection]->Clone(CurrentFunction->GetNodePool());
 				}
 				else
 				{
@@ -925,7 +1231,7 @@ bool Alchemist::PaletteHandleEvent(SDL_Event& Event)
 			{
 				if (NodeOnMouse)
 				{
-					CurrentFunction->RemoveNode(NodeOnMouse);
+					History.RemoveNode(CurrentFunction, NodeOnMouse);
 					NodeOnMouse.reset();
 				}
 
@@ -957,6 +1263,9 @@ bool Alchemist::GridHandleEvent(SDL_Event& Event)
 			}
 			else if (Event.button.button == 1)
 			{
+				// Everything from here until the next click is undone together.
+				History.BeginGesture();
+
 				if (NodeBeingConnected)
 				{
 					if (NodeBeingConnectedTo)
@@ -979,7 +1288,7 @@ bool Alchemist::GridHandleEvent(SDL_Event& Event)
 							if (EventMousePosition.IsInRectangle(OptionRect))
 							{
 								// Make a connection between arg i and the node, being connected, then break.
-								NodeBeingConnectedTo->SetConnector(NodeBeingConnected, i);
+								History.SetConnector(CurrentFunction, NodeBeingConnectedTo, NodeBeingConnected, i);
 								break;
 							}
 						}
@@ -998,7 +1307,7 @@ bool Alchemist::GridHandleEvent(SDL_Event& Event)
 
 				if (NodeOnMouse && Copy)
 				{
-					NodeOnMouse = NodeOnMouse->Clone();
+					NodeOnMouse = NodeOnMouse->Clone(CurrentFunction->GetNodePool());
 				}
 
 				return true;
@@ -1036,7 +1345,7 @@ bool Alchemist::GridHandleEvent(SDL_Event& Event)
 					NodeLastSelected = NodeOnMouse;
 
 					Point MouseGridPosition = ScreenToGrid(Point(Event.motion.x, Event.motion.y));
-					CurrentFunction->PlaceNode(NodeOnMouse, MouseGridPosition);
+					History.PlaceNode(CurrentFunction, NodeOnMouse, MouseGridPosition);
 
 					NodeOnMouse.reset();
 					
@@ -1087,13 +1396,29 @@ bool Alchemist::GridHandleEvent(SDL_Event& Event)
 			{
 				Copy = true;
 			}
+			else if ((Event.key.keysym.mod & KMOD_CTRL) && Event.key.keysym.sym == SDLK_z)
+			{
+				if (Event.key.keysym.mod & KMOD_SHIFT)
+				{
+					Redo();
+				}
+				else
+				{
+					Undo();
+				}
+			}
+			else if ((Event.key.keysym.mod & KMOD_CTRL) && Event.key.keysym.sym == SDLK_y)
+			{
+				Redo();
+			}
 			else if (Event.key.keysym.sym == SDLK_DELETE)
 			{
 				shared_ptr<Node> LastSelectedLock = NodeLastSelected.lock();
 
 				if (LastSelectedLock)
 				{
-					CurrentFunction->RemoveNode(LastSelectedLock);
+					History.BeginGesture();
+					History.RemoveNode(CurrentFunction, LastSelectedLock);
 				}
 			}
 			else
@@ -1102,7 +1427,10 @@ bool Alchemist::GridHandleEvent(SDL_Event& Event)
 
 				if (LastSelectedLock)
 				{
-					LastSelectedLock->HandleKeyPress(Event);
+					History.EditNode(CurrentFunction, LastSelectedLock, [&LastSelectedLock, &Event]()
+					{
+						LastSelectedLock->HandleKeyPress(Event);
+					});
 				}
 			}
 
@@ -1123,7 +1451,10 @@ bool Alchemist::GridHandleEvent(SDL_Event& Event)
 
 			if (LastSelectedLock)
 			{
-				LastSelectedLock->HandleTextInput(Event);
+				History.EditNode(CurrentFunction, LastSelectedLock, [&LastSelectedLock, &Event]()
+				{
+					LastSelectedLock->HandleTextInput(Event);
+				});
 			}
 
 			return true;
@@ -1181,9 +1512,9 @@ void Alchemist::DrawConnectorArrowOnGrid(const Point& Point1, const Point& Point
 		// Now draw it
 		shared_ptr<Resource_Font> Font = GetDefaultFont();
 
-		string IdStr = to_string(ConnectorId+1);
+		FrameString IdStr = NewFrameString();
+		AppendInt(IdStr, ConnectorId+1);
 
-		SDL_Texture* DisplayTexture = Font->GetStringTexture(IdStr, 18);
 		::Size DisplaySize = Font->GetStringScreenSize(IdStr, 18);
 
 		SDL_Rect DisplayRect;
@@ -1198,16 +1529,14 @@ void Alchemist::DrawConnectorArrowOnGrid(const Point& Point1, const Point& Point
 			DisplayRect.x -= DisplayRect.w;
 		}
 
-		SDL_SetTextureColorMod(DisplayTexture, 0, 0, 0);
-		SDL_RenderCopy(Renderer, DisplayTexture, NULL, &DisplayRect);
+		Font->DrawString(IdStr, Point(DisplayRect.x, DisplayRect.y), 18);
 	}
 }
 
-void Alchemist::DrawTooltip(const string& Text, int YOffset, int Size) const
+void Alchemist::DrawTooltip(string_view Text, int YOffset, int Size) const
 {
 	shared_ptr<Resource_Font> Font = GetDefaultFont();
 
-	SDL_Texture* DisplayTexture = Font->GetStringTexture(Text, Size);
 	::Size DisplaySize = Font->GetStringScreenSize(Text, Size);
 
 	SDL_Rect DisplayRect;
@@ -1222,13 +1551,15 @@ void Alchemist::DrawTooltip(const string& Text, int YOffset, int Size) const
 		DisplayRect.x -= DisplayRect.w;
 	}
 
-	SDL_SetTextureColorMod(DisplayTexture, 0, 0, 0);
-	SDL_RenderCopy(Renderer, DisplayTexture, NULL, &DisplayRect);
+	Font->DrawString(Text, Point(DisplayRect.x, DisplayRect.y), Size);
 }
 
 void Alchemist::DrawNodeTooltip(const shared_ptr<Node>& NodeIn) const
 {
-	string NodeDetailText = NodeIn->GetDisplayName() + ":" + to_string(NodeIn->GetNumArguments());
+	FrameString NodeDetailText = NewFrameString();
+	NodeDetailText += NodeIn->GetDisplayName();
+	NodeDetailText += ":";
+	AppendInt(NodeDetailText, NodeIn->GetNumArguments());
 
 	DrawTooltip(NodeDetailText);
 
@@ -1236,14 +1567,49 @@ void Alchemist::DrawNodeTooltip(const shared_ptr<Node>& NodeIn) const
 	
 	for(int i = 0; i < NodeIn->GetNumArguments(); i++)
 	{
-		if(shared_ptr<Node> Connector = NodeIn->GetConnector(i))
+		if(Node* Connector = NodeIn->GetConnector(i))
+		{
+			FrameString DetailText = NewFrameString();
+			DetailText += NodeIn->GetArgumentName(i);
+			DetailText += " = ";
+			DetailText += Connector->GetDisplayName();
+			DetailText += ":";
+			AppendInt(DetailText, Connector->GetNumArguments());
+
+			DrawTooltip(DetailText, 30 + (Num * 20), 18);
+
+			Num++;
+		}
+	}
+
+	// Then where its value goes.
+	for (const NodeConsumer& Entry : NodeIn->GetConsumers())
+	{
+		if (Node* Consumer = NodeIn->GetFunction()->GetNode(Entry.Consumer))
 		{
-			string DetailText = NodeIn->GetArgumentName(i) + " = " + Connector->GetDisplayName() + ":" + to_string(Connector->GetNumArguments());
+			FrameString DetailText = NewFrameString();
+			DetailText += Consumer->GetDisplayName();
+			DetailText += ".";
+			DetailText += Consumer->GetArgumentName(Entry.Argument);
+			DetailText += " = ";
+			DetailText += NodeIn->GetDisplayName();
+
 			DrawTooltip(DetailText, 30 + (Num * 20), 18);
 
 			Num++;
 		}
 	}
+
+	// Then whatever was wrong with it last compile.
+	if (const vector<string>* Problems = CompileDiagnostics.GetProblems(NodeIn.get()))
+	{
+		for (const string& Problem : *Problems)
+		{
+			DrawTooltip(Problem, 30 + (Num * 20), 18);
+
+			Num++;
+		}
+	}
 }
 
 shared_ptr<Resource_Font> Alchemist::GetDefaultFont() const
@@ -1251,9 +1617,19 @@ shared_ptr<Resource_Font> Alchemist::GetDefaultFont() const
 	return Resources.GetResource<Resource_Font>("Font.ttf");
 }
 
-vector<ToolbarOptionData> Alchemist::GetToolbarOptions() const
+const vector<ToolbarOptionData>& Alchemist::GetToolbarOptions() const
 {
-	vector<ToolbarOptionData> Out;
+	// The options only show function signatures, so they're only rebuilt when those change or another function is viewed.
+	if (ToolbarOptionsSignatureVersion == CurrentModule.GetSignatureVersion() && ToolbarOptionsFunction == CurrentFunction.get())
+	{
+		return ToolbarOptions;
+	}
+
+	ToolbarOptionsSignatureVersion = CurrentModule.GetSignatureVersion();
+	ToolbarOptionsFunction = CurrentFunction.get();
+
+	vector<ToolbarOptionData>& Out = ToolbarOptions;
+	Out.clear();
 	
 	// First option is the "[name of the function]:[arity]", example: main:0
 	// Contains these options AS LONG AS the function name is NOT "Main":
@@ -1274,6 +1650,8 @@ vector<ToolbarOptionData> Alchemist::GetToolbarOptions() const
 					},
 					[](Alchemist* Instance)
 					{
+						// Edits made to or calling the function can't be undone once it's gone.
+						Instance->GetEditHistory()->Clear();
 						Instance->GetCurrentModule()->RemoveFunction(Instance->GetCurrentFunction()->GetName());
 						Instance->ViewFunction("Main");
 					}
@@ -1297,7 +1675,7 @@ vector<ToolbarOptionData> Alchemist::GetToolbarOptions() const
 	// Second option is "Program"
 	// Contains:
 	// - New function
-	// - Generate code
+	// - Save and load (not on the web, there's nowhere to keep the file)
 	{
 		ToolbarOptionData Options = {
 			"Program...",
@@ -1311,10 +1689,46 @@ vector<ToolbarOptionData> Alchemist::GetToolbarOptions() const
 			}
 		};
 
+#if !IS_WEB
+		Options.SubOptions.push_back("Save Project");
+		Options.SelectFunctions.push_back([](Alchemist* Instance)
+		{
+			Instance->SaveProject();
+		});
+
+		Options.SubOptions.push_back("Load Project");
+		Options.SelectFunctions.push_back([](Alchemist* Instance)
+		{
+			Instance->OpenProject(Instance->ProjectPath);
+		});
+#endif
+
+		Out.push_back(Options);
+	}
+
+	// Third option is "Edit"
+	// Contains:
+	// - Undo and redo
+	{
+		ToolbarOptionData Options = {
+			"Edit...",
+			{ "Undo (Ctrl+Z)", "Redo (Ctrl+Y)" },
+			{
+				[](Alchemist* Instance)
+				{
+					Instance->Undo();
+				},
+				[](Alchemist* Instance)
+				{
+					Instance->Redo();
+				}
+			}
+		};
+
 		Out.push_back(Options);
 	}
 
-	// Third option is "View"
+	// Fourth option is "View"
 	// Contains every function signature in the program.
 	{
 		ToolbarOptionData Options = {
@@ -1323,7 +1737,7 @@ vector<ToolbarOptionData> Alchemist::GetToolbarOptions() const
 			{}
 		};
 
-		auto Functions = CurrentModule.GetFunctions();
+		const vector<shared_ptr<Function>>& Functions = CurrentModule.GetFunctions();
 		
 		for(int i = 0; i < Functions.size(); i++)
 		{
@@ -1339,7 +1753,7 @@ vector<ToolbarOptionData> Alchemist::GetToolbarOptions() const
 		Out.push_back(Options);
 	}
 	
-	// Forth option is "About"
+	// Fifth option is "About"
 	// - Non-clickable version number
 	// - Copyright Chris Sixsmith 2020.
 	{
@@ -1358,7 +1772,7 @@ vector<ToolbarOptionData> Alchemist::GetToolbarOptions() const
 int Alchemist::GetToolbarOptionX(int OptionId) const
 {
 	int X = ToolbarPadding + 64;
-	auto Options = GetToolbarOptions();
+	const vector<ToolbarOptionData>& Options = GetToolbarOptions();
 	shared_ptr<Resource_Font> Font = GetDefaultFont();
 	
 	for(int i = 0; i < OptionId && i < Options.size(); i++)
@@ -1371,7 +1785,7 @@ int Alchemist::GetToolbarOptionX(int OptionId) const
 
 SDL_Rect Alchemist::GetToolbarOptionSelectionRect(int OptionId) const
 {
-	auto Options = GetToolbarOptions();
+	const vector<ToolbarOptionData>& Options = GetToolbarOptions();
 	
 	shared_ptr<Resource_Font> Font = GetDefaultFont();
 	
@@ -1386,7 +1800,7 @@ SDL_Rect Alchemist::GetToolbarOptionSelectionRect(int OptionId) const
 SDL_Rect Alchemist::GetToolbarSubOptionRect(int OptionId, int SubOptionId) const
 {
 	int SubOptionMenuWidth = 0;
-	auto Options = GetToolbarOptions();
+	const vector<ToolbarOptionData>& Options = GetToolbarOptions();
 
 	shared_ptr<Resource_Font> Font = GetDefaultFont();
 	
@@ -7,7 +7,12 @@
 #include "Nodes/Nodes.h"
 #include "Resources/Resources.h"
 #include "Module/Module.h"
+#include "Module/EditHistory.h"
 #include "Resources/Resource_Font.h"
+#include "FrameArena.h"
+#include "RenderLayer.h"
+#include "Compiler/CompileService.h"
+#include "Compiler/Diagnostics.h"
 
 const int GridSize = 64;
 const int SidebarWidth = 400;
@@ -17,6 +22,7 @@ const int ConnectMenuOptionPadding = 16;
 const int ToolbarPadding = 4;
 const int ToolbarHeight = 40;
 const int ToolbarOptionHeight = 40;
+const int DefaultFrameCap = 60;
 
 struct ToolbarOptionData
 {
@@ -39,11 +45,21 @@ public:
 	/** Will run the environment until the user closes it. */
 	void Run();
 
-	/** Will attempt to compile the program the user has created. */
+	/**
+	 * Will attempt to compile the program the user has created. Does nothing if the module hasn't changed since the last compile.
+	 * Emitting happens in the background - its result is picked up by a later Frame. Until then this does nothing, and changes made meanwhile go in the next compile.
+	 * Freezing the module for the compiler still happens here, on the UI thread: O(functions), plus O(nodes) for each function edited since the last compile (see Module::Freeze).
+	 */
 	void Compile();
 	
-	/** Core loop inner function. Processes a single Frame when called. */
+	/** Core loop inner function. Processes a single Frame when called. Only draws if something changed since the last frame that did. */
 	void Frame();
+
+	/**
+	 * Limits how many frames are drawn per second, or 0 for no limit beyond vsync. Frames are only drawn when something has changed either way.
+	 * The web build ignores this, as the browser paces frames itself.
+	 */
+	void SetFrameCap(int FramesPerSecond) { FrameCap = max(FramesPerSecond, 0); }
 	
 	/** Handles emscripten ui resize event. */
 #if IS_WEB
@@ -90,6 +106,9 @@ public:
 
 	/** Returns the module. */
 	Module* GetCurrentModule() { return &CurrentModule; }
+
+	/** Returns the log of the user's edits. Make changes to the program through this, so they can be undone. */
+	EditHistory* GetEditHistory() { return &History; }
 	
 	/** Returns window size. */
 	Size GetWindowSize() const;
@@ -106,19 +125,55 @@ public:
 	/** Edits function signature. */
 	void EditFunctionSignature();
 
+	/** Undoes the user's last edit, and views the function it was made in. */
+	void Undo();
+
+	/** Redoes the user's last undone edit, and views the function it was made in. */
+	void Redo();
+
+	/** Sets the file the project is saved to, and loads it if it already exists. Returns false if it exists but couldn't be loaded. */
+	bool OpenProject(const string& Path);
+
+	/** Saves the project to the file it was opened from. Returns false if it couldn't be saved. */
+	bool SaveProject() const;
+
 private:	
 	/** Gets window start size. */
 	Size GetWindowStartSize() const;
 
+	/**
+	 * Collects and outputs the result of the last compile, if it has finished. Returns false if there was nothing to collect.
+	 * Runs on the UI thread: O(functions) to store the results and diagnostics, then O(output size) to write the output.
+	 */
+	bool ReceiveCompileResult();
+
+	/** Handles an event from the queue. */
+	void HandleEvent(SDL_Event& Event);
+
+	/** Returns how many milliseconds to wait before the frame cap allows another frame to be drawn. */
+	Uint32 GetTimeUntilNextFrame() const;
+
 	/** Draws the toolbar. */
 	void DrawToolbar() const;
+
+	/** Draws the toolbar's cached layer (everything in the toolbar and its menus). */
+	void DrawToolbarLayer() const;
 	
 	/** Draws the node palette. */
 	void DrawNodePalette() const;
+
+	/** Draws the node palette's cached layer (everything except tooltips, which follow the mouse). */
+	void DrawNodePaletteLayer() const;
 	
 	/** Draws the grid. */
 	void DrawGrid() const;
 
+	/** Draws the grid's cached layer (the background and grid lines), a grid square bigger than the window, with the first lines at the origin given. */
+	void DrawGridLayer(const Point& Origin) const;
+
+	/** Destroys the cached layers, so they are drawn again next frame. */
+	void ReleaseLayers();
+
 	/** Tries to make the toolbar handle an event. */
 	bool ToolbarHandleEvent(SDL_Event& Event);
 	
@@ -135,16 +190,19 @@ private:
 	void DrawConnectorArrowOnGrid(const Point& Point1, const Point& Point2, int ConnectorId = -1) const;
 
 	/** Draws a tooltip. */
-	void DrawTooltip(const string& Text, int YOffset = 0, int Size = 30) const;
+	void DrawTooltip(string_view Text, int YOffset = 0, int Size = 30) const;
 	
 	/** Draws tooltip. */
 	void DrawNodeTooltip(const shared_ptr<Node>& Node) const;
 
+	/** Returns an empty string in the frame arena, for building text that is only drawn this frame. */
+	FrameString NewFrameString() const { return FrameString(FrameAllocator<char>(Arena)); }
+
 	/** Returns the default font. */
 	shared_ptr<Resource_Font> GetDefaultFont() const;
 
-	/** Returns the current list of toolbar options. */
-	vector<ToolbarOptionData> GetToolbarOptions() const;
+	/** Returns the current list of toolbar options. Kept between calls, so don't hold on to it past anything that changes the program. */
+	const vector<ToolbarOptionData>& GetToolbarOptions() const;
 
 	/** Calculates toolbar option X position. */
 	int GetToolbarOptionX(int OptionId) const;
@@ -183,9 +241,37 @@ private:
 	Module CurrentModule;
 	shared_ptr<Function> CurrentFunction;
 
+	EditHistory History;
+
 	int ToolbarOpenMenu = -1;
 
+	// The toolbar options, and what they were built for
+	mutable vector<ToolbarOptionData> ToolbarOptions;
+	mutable int ToolbarOptionsSignatureVersion = -1;
+	mutable const Function* ToolbarOptionsFunction = nullptr;
+
 	bool EditingFunctionSignature = false;
 
-	vector<CompilationProblem> ProblemsFromLastCompile;
+	CompileService Compiler;
+
+	// Pushed by the compiler when it has a result, so a loop waiting for events wakes up to collect it.
+	Uint32 CompileResultEvent = 0;
+
+	Diagnostics CompileDiagnostics;
+	int LastCompiledModuleVersion = -1;
+
+	string ProjectPath;
+
+	// Frame scheduling. Nothing is drawn until something marks the screen out of date, and then no sooner than the frame cap allows.
+	bool NeedsRedraw = true;
+	int FrameCap = DefaultFrameCap;
+	Uint32 LastFrameTime = 0;
+
+	// Memory for things that only last one frame. Reset at the start of every frame.
+	mutable FrameArena Arena;
+
+	// Parts of the screen that are only redrawn when what they show changes
+	mutable RenderLayer GridLayer;
+	mutable RenderLayer PaletteLayer;
+	mutable RenderLayer ToolbarLayer;
 };
@@ -4,6 +4,8 @@
 
 #include "Libs.h"
 
+class Node;
+
 /* Compile error info. */
 struct CompilationProblem
 {
@@ -0,0 +1,182 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "CompileService.h"
+#include "Module/Function.h"
+
+CompileService::CompileService()
+	: EmitJobs(JobPool::GetDefaultThreadCount())
+{
+#if !IS_WEB
+	Worker = thread(&CompileService::WorkerLoop, this);
+#endif
+}
+
+CompileService::~CompileService()
+{
+#if !IS_WEB
+	{
+		lock_guard<mutex> Lock(Mutex);
+		Stopping = true;
+	}
+
+	WorkAvailable.notify_one();
+	Worker.join();
+#endif
+}
+
+void CompileService::Submit(const shared_ptr<const FrozenModule>& Frozen)
+{
+#if !IS_WEB
+	{
+		lock_guard<mutex> Lock(Mutex);
+
+		LatestGeneration++;
+
+		Pending = Frozen;
+		PendingGeneration = LatestGeneration;
+	}
+
+	WorkAvailable.notify_one();
+#else
+	LatestGeneration++;
+	Completed.push_back({ LatestGeneration, CompileFrozen(*Frozen) });
+	FinishedGeneration = LatestGeneration;
+
+	if (ResultCallback)
+	{
+		ResultCallback();
+	}
+#endif
+}
+
+bool CompileService::PollResult(CompileResult& Out)
+{
+	lock_guard<mutex> Lock(Mutex);
+
+	bool Found = false;
+
+	for (pair<int, CompileResult>& Result : Completed)
+	{
+		// Anything that isn't from the newest frozen module is stale.
+		if (Result.first == LatestGeneration)
+		{
+			Out = move(Result.second);
+			Found = true;
+		}
+	}
+
+	Completed.clear();
+
+	return Found;
+}
+
+bool CompileService::IsBusy() const
+{
+	lock_guard<mutex> Lock(Mutex);
+	return FinishedGeneration != LatestGeneration;
+}
+
+void CompileService::SetResultCallback(function<void()> Callback)
+{
+	lock_guard<mutex> Lock(Mutex);
+	ResultCallback = move(Callback);
+}
+
+CompileResult CompileService::CompileFrozen(const FrozenModule& Frozen, JobPool* Pool)
+{
+	CompileResult Result;
+	Result.ModuleVersion = Frozen.ModuleVersion;
+
+	// Functions that haven't changed since they were last emitted already have their code.
+	vector<const FrozenModuleEntry*> ToEmit;
+
+	for (const FrozenModuleEntry& Func : Frozen.Functions)
+	{
+		if (Func.NeedsEmit)
+		{
+			ToEmit.push_back(&Func);
+		}
+	}
+
+	// Every function gets its own slot up front, so the order of the result never depends on which one finished first.
+	Result.Functions.resize(ToEmit.size());
+
+	auto EmitFunction = [&ToEmit, &Result](size_t Index)
+	{
+		// Each function only reads its own frozen nodes, plus the names and arities of the functions it calls.
+		const FrozenModuleEntry& Func = *ToEmit[Index];
+
+		FunctionCompileResult& FuncResult = Result.Functions[Index];
+		FuncResult.Source = Func.Source;
+		FuncResult.Version = Func.Version;
+
+		FuncResult.Code.Reserve(Func.CodeSizeHint);
+
+		vector<CompilationProblem> Problems;
+		FuncResult.Pass = Func.Frozen->Copy->Emit(FuncResult.Code, Problems);
+
+		// Problems were found on the copies, but whoever gets the result only knows the originals.
+		for (const CompilationProblem& Problem : Problems)
+		{
+			FuncResult.Problems.push_back(Func.Frozen->ToSource(Problem));
+		}
+	};
+
+	if (Pool)
+	{
+		Pool->Run(ToEmit.size(), EmitFunction);
+	}
+	else
+	{
+		for (size_t i = 0; i < ToEmit.size(); i++)
+		{
+			EmitFunction(i);
+		}
+	}
+
+	return Result;
+}
+
+void CompileService::WorkerLoop()
+{
+#if !IS_WEB
+	while (true)
+	{
+		shared_ptr<const FrozenModule> Frozen;
+		int Generation;
+
+		{
+			unique_lock<mutex> Lock(Mutex);
+			WorkAvailable.wait(Lock, [this] { return Pending || Stopping; });
+
+			if (Stopping)
+			{
+				return;
+			}
+
+			Frozen = move(Pending);
+			Pending.reset();
+			Generation = PendingGeneration;
+		}
+
+		CompileResult Result = CompileFrozen(*Frozen, &EmitJobs);
+
+		{
+			lock_guard<mutex> Lock(Mutex);
+
+			FinishedGeneration = Generation;
+
+			// Don't bother queueing it if a newer frozen module came in meanwhile.
+			if (Generation == LatestGeneration)
+			{
+				Completed.push_back({ Generation, move(Result) });
+
+				if (ResultCallback)
+				{
+					ResultCallback();
+				}
+			}
+		}
+	}
+#endif
+}
@@ -0,0 +1,111 @@
+// Copyright Chris Sixsmith 2020.
+
+#pragma once
+
+#include "Libs.h"
+#include "CompilationProblem.h"
+#include "Module/FrozenModule.h"
+#include "Compiler/EmitSink.h"
+#include "Compiler/JobPool.h"
+
+/** The result of emitting one function from a frozen module. */
+struct FunctionCompileResult
+{
+	/** The live function that was emitted. */
+	weak_ptr<Function> Source;
+
+	/** The live function's version when it was copied. */
+	int Version = 0;
+
+	bool Pass = false;
+	EmitSink Code;
+
+	/** Problems, already pointing at the live nodes. */
+	vector<CompilationProblem> Problems;
+};
+
+/** The result of compiling a frozen module. */
+struct CompileResult
+{
+	/** The version of the module when it was frozen. */
+	int ModuleVersion = 0;
+
+	/** One entry per function the frozen module said needed emitting, in module order - however many threads emitted them. */
+	vector<FunctionCompileResult> Functions;
+};
+
+/**
+ * Compile service.
+ * Emits frozen modules on a worker thread, so that slow emitting doesn't hold up the frame loop.
+ * Freezing the module isn't part of this - it's done by the caller before Submit, on the caller's thread (see Module::Freeze).
+ * - Submit a frozen module, then poll for its result every frame (or whenever the result callback says one is ready).
+ * - Only the newest frozen module matters. Older frozen modules still waiting are replaced, and older results are dropped.
+ * - Functions in a frozen module don't depend on each other's code, so they are emitted in parallel across a job pool.
+ * - Without threads (i.e. the web build) frozen modules are compiled as soon as they are submitted, and the result is polled the same way.
+ */
+class CompileService
+{
+public:
+	CompileService();
+	~CompileService();
+
+	// Non copyable!
+	CompileService(const CompileService&) = delete;
+	CompileService& operator=(const CompileService&) = delete;
+
+	/** Queues a frozen module to be compiled. Replaces any frozen module that hasn't been started yet. */
+	void Submit(const shared_ptr<const FrozenModule>& Frozen);
+
+	/**
+	 * Takes the result for the newest submitted frozen module, if it has finished.
+	 * Returns false if there's nothing new.
+	 */
+	bool PollResult(CompileResult& Out);
+
+	/** Returns true if a submitted frozen module hasn't finished compiling yet. */
+	bool IsBusy() const;
+
+	/**
+	 * Sets a function to call whenever a result is ready to poll, so a loop that sleeps between frames can be woken up to take it.
+	 * It's called from the worker thread with the service locked, so it should only pass the news on (i.e. push an event) rather than poll here.
+	 */
+	void SetResultCallback(function<void()> Callback);
+
+	/**
+	 * Compiles a frozen module. Functions are shared out over the pool if one is given, otherwise they're emitted one by one on the calling thread.
+	 * Either way the result is the same.
+	 */
+	static CompileResult CompileFrozen(const FrozenModule& Frozen, JobPool* Pool = nullptr);
+
+private:
+	/** Worker thread body. */
+	void WorkerLoop();
+
+private:
+	mutable mutex Mutex;
+
+	// Frozen module waiting for the worker, and its generation.
+	shared_ptr<const FrozenModule> Pending;
+	int PendingGeneration = 0;
+	
+	// Completion queue, paired with the generation of the frozen module each result came from.
+	vector<pair<int, CompileResult>> Completed;
+
+	// Generation of the newest submitted frozen module. Results from any other generation are stale.
+	int LatestGeneration = 0;
+
+	// Generation of the last frozen module the worker finished, whether its result was kept or not.
+	int FinishedGeneration = 0;
+
+	// Called when a result is queued.
+	function<void()> ResultCallback;
+
+	// Emits the functions of each frozen module.
+	JobPool EmitJobs;
+
+#if !IS_WEB
+	condition_variable WorkAvailable;
+	bool Stopping = false;
+	thread Worker;
+#endif
+};
@@ -0,0 +1,94 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "ConstantValue.h"
+#include "EmitSink.h"
+
+ConstantValue ConstantValue::MakeInteger(int64_t Value)
+{
+	ConstantValue Out;
+	Out.ValueType = Type::Integer;
+	Out.Integer = Value;
+
+	return Out;
+}
+
+ConstantValue ConstantValue::MakeBoolean(bool Value)
+{
+	ConstantValue Out;
+	Out.ValueType = Type::Atom;
+	Out.Boolean = Value;
+
+	return Out;
+}
+
+void ConstantValue::Emit(EmitSink& Output) const
+{
+	assert(IsKnown());
+
+	if (ValueType == Type::Integer)
+	{
+		Output += to_string(Integer);
+	}
+	else
+	{
+		Output += Boolean ? "true" : "false";
+	}
+}
+
+int ConstantValue::Compare(const ConstantValue& LHS, const ConstantValue& RHS)
+{
+	assert(LHS.IsKnown() && RHS.IsKnown());
+
+	if (LHS.ValueType != RHS.ValueType)
+	{
+		return LHS.ValueType == Type::Integer ? -1 : 1;
+	}
+
+	if (LHS.ValueType == Type::Integer)
+	{
+		return LHS.Integer < RHS.Integer ? -1 : (LHS.Integer > RHS.Integer ? 1 : 0);
+	}
+
+	// 'false' sorts before 'true'.
+	return (int)LHS.Boolean - (int)RHS.Boolean;
+}
+
+bool ConstantValue::AddIntegers(int64_t LHS, int64_t RHS, int64_t& Out)
+{
+	if ((RHS > 0 && LHS > INT64_MAX - RHS) || (RHS < 0 && LHS < INT64_MIN - RHS))
+	{
+		return false;
+	}
+
+	Out = LHS + RHS;
+	return true;
+}
+
+bool ConstantValue::SubtractIntegers(int64_t LHS, int64_t RHS, int64_t& Out)
+{
+	if ((RHS < 0 && LHS > INT64_MAX + RHS) || (RHS > 0 && LHS < INT64_MIN + RHS))
+	{
+		return false;
+	}
+
+	Out = LHS - RHS;
+	return true;
+}
+
+bool ConstantValue::MultiplyIntegers(int64_t LHS, int64_t RHS, int64_t& Out)
+{
+	if (LHS != 0 && RHS != 0)
+	{
+		bool Overflows = LHS > 0
+			? (RHS > 0 ? LHS > INT64_MAX / RHS : RHS < INT64_MIN / LHS)
+			: (RHS > 0 ? LHS < INT64_MIN / RHS : RHS < INT64_MAX / LHS);
+
+		if (Overflows)
+		{
+			return false;
+		}
+	}
+
+	Out = LHS * RHS;
+	return true;
+}
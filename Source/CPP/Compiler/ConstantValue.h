@@ -0,0 +1,47 @@
+// Copyright Chris Sixsmith 2020.
+
+#pragma once
+
+#include "Libs.h"
+#include "Variables.h"
+
+class EmitSink;
+
+/**
+ * Constant value.
+ * The value of an expression that could be worked out while compiling, so it can be emitted as a literal instead of the expression.
+ * - Only integers and booleans are known about so far. Booleans are the atoms true and false, as they are in Erlang.
+ * - Integers are kept to 64 bits. Erlang integers never overflow, so anything that would is left for the runtime to work out.
+ */
+struct ConstantValue
+{
+	/** Type::Integer or Type::Atom. Type::Invalid means the value isn't known. */
+	Type ValueType = Type::Invalid;
+
+	int64_t Integer = 0;
+	bool Boolean = false;
+
+	static ConstantValue MakeInteger(int64_t Value);
+	static ConstantValue MakeBoolean(bool Value);
+
+	/** Returns whether the value is known. */
+	bool IsKnown() const { return ValueType != Type::Invalid; }
+
+	/** Returns whether this is the given integer. */
+	bool IsInteger(int64_t Value) const { return ValueType == Type::Integer && Integer == Value; }
+
+	/** Returns whether this is the given boolean. */
+	bool IsBoolean(bool Value) const { return ValueType == Type::Atom && Boolean == Value; }
+
+	/** Emits the value as an Erlang literal. */
+	void Emit(EmitSink& Output) const;
+
+	/** Compares two known values in Erlang term order (numbers come before atoms). Returns less than, equal to or greater than zero. */
+	static int Compare(const ConstantValue& LHS, const ConstantValue& RHS);
+
+	// Integer arithmetic. These return false rather than overflowing.
+
+	static bool AddIntegers(int64_t LHS, int64_t RHS, int64_t& Out);
+	static bool SubtractIntegers(int64_t LHS, int64_t RHS, int64_t& Out);
+	static bool MultiplyIntegers(int64_t LHS, int64_t RHS, int64_t& Out);
+};
@@ -0,0 +1,160 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "Diagnostics.h"
+#include "Module/Function.h"
+#include "Nodes/Nodes.h"
+
+void Diagnostics::Update(const vector<shared_ptr<Function>>& NewFunctions)
+{
+	bool Changed = false;
+
+	// Drop functions that were removed since the last update.
+	unordered_set<const Function*> Present;
+
+	for (const shared_ptr<Function>& Func : NewFunctions)
+	{
+		Present.insert(Func.get());
+	}
+
+	for (auto It = Functions.begin(); It != Functions.end();)
+	{
+		if (Present.find(It->first) == Present.end() || It->second.Source.expired())
+		{
+			UnindexFunction(It->first, It->second);
+			It = Functions.erase(It);
+			Changed = true;
+		}
+		else
+		{
+			++It;
+		}
+	}
+
+	// Then store anything emitted since.
+	vector<const Function*> NewOrder;
+	NewOrder.reserve(NewFunctions.size());
+
+	for (const shared_ptr<Function>& Func : NewFunctions)
+	{
+		NewOrder.push_back(Func.get());
+
+		FunctionEntry& Entry = Functions[Func.get()];
+
+		if (Entry.EmittedVersion != Func->GetCachedVersion())
+		{
+			StoreFunction(Func, Entry);
+			Changed = true;
+		}
+	}
+
+	if (NewOrder != FunctionOrder)
+	{
+		FunctionOrder = move(NewOrder);
+		Changed = true;
+	}
+
+	if (Changed)
+	{
+		Version++;
+	}
+}
+
+void Diagnostics::Clear()
+{
+	Functions.clear();
+	Nodes.clear();
+	FunctionOrder.clear();
+	ProblemCount = 0;
+
+	Version++;
+}
+
+bool Diagnostics::HasProblem(const Node* ProblemNode) const
+{
+	return GetProblems(ProblemNode) != nullptr;
+}
+
+const vector<string>* Diagnostics::GetProblems(const Node* ProblemNode) const
+{
+	auto Found = Nodes.find(ProblemNode);
+
+	if (Found == Nodes.end() || Found->second.Source.expired())
+	{
+		return nullptr;
+	}
+
+	return &Found->second.Problems;
+}
+
+const string& Diagnostics::GetReport() const
+{
+	if (ReportVersion == Version)
+	{
+		return Report;
+	}
+
+	Report.clear();
+
+	for (const Function* Func : FunctionOrder)
+	{
+		const FunctionEntry& Entry = Functions.find(Func)->second;
+
+		for (const ProblemEntry& Problem : Entry.Problems)
+		{
+			Report += "- (In " + Entry.Signature + " @ (" + to_string(Problem.Position.X) + ", " + to_string(Problem.Position.Y) + ")) " + Problem.Problem + "\n";
+		}
+	}
+
+	ReportVersion = Version;
+
+	return Report;
+}
+
+void Diagnostics::StoreFunction(const shared_ptr<Function>& Func, FunctionEntry& Entry)
+{
+	UnindexFunction(Func.get(), Entry);
+
+	Entry.Source = Func;
+	Entry.EmittedVersion = Func->GetCachedVersion();
+	Entry.Signature = Func->GetName() + ":" + to_string(Func->GetArity());
+	Entry.Problems.clear();
+
+	for (const CompilationProblem& Problem : Func->GetCachedProblems())
+	{
+		shared_ptr<Node> ProblemNode = Problem.ProblemNode.lock();
+
+		if (!ProblemNode)
+		{
+			continue; // deleted since
+		}
+
+		Entry.Problems.push_back(ProblemEntry{ ProblemNode.get(), ProblemNode->GetGridPosition(), Problem.Problem });
+
+		NodeEntry& Indexed = Nodes[ProblemNode.get()];
+
+		if (Indexed.Source.lock() != ProblemNode)
+		{
+			Indexed = NodeEntry{ ProblemNode, Func.get() };
+		}
+
+		Indexed.Problems.push_back(Problem.Problem);
+	}
+
+	ProblemCount += Entry.Problems.size();
+}
+
+void Diagnostics::UnindexFunction(const Function* Func, const FunctionEntry& Entry)
+{
+	for (const ProblemEntry& Problem : Entry.Problems)
+	{
+		auto Found = Nodes.find(Problem.ProblemNode);
+
+		// Another function may have a new node at the same address by now.
+		if (Found != Nodes.end() && Found->second.Owner == Func)
+		{
+			Nodes.erase(Found);
+		}
+	}
+
+	ProblemCount -= Entry.Problems.size();
+}
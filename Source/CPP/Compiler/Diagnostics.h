@@ -0,0 +1,91 @@
+// Copyright Chris Sixsmith 2020.
+
+#pragma once
+
+#include "Libs.h"
+#include "2DPositioning.h"
+#include "CompilationProblem.h"
+
+class Function;
+class Node;
+
+/**
+ * Diagnostics.
+ * The problems from the last emit of every function, indexed by function and by node.
+ * - Update() only rebuilds entries for functions that were emitted again since the last update.
+ * - Asking whether a node has a problem is one hash lookup, so the grid can check every node it draws.
+ * - The text report is built when asked for, and then reused until the problems change.
+ */
+class Diagnostics
+{
+public:
+	/** Brings the diagnostics up to date with the functions' cached emit results. Functions that aren't in the list are dropped. */
+	void Update(const vector<shared_ptr<Function>>& Functions);
+
+	/** Forgets every problem. */
+	void Clear();
+
+	/** Returns whether the node had any problems in the last emit of its function. */
+	bool HasProblem(const Node* ProblemNode) const;
+
+	/** Returns the problems on a node, or null if there aren't any. */
+	const vector<string>* GetProblems(const Node* ProblemNode) const;
+
+	/** Returns how many problems there are in total. */
+	size_t GetProblemCount() const { return ProblemCount; }
+
+	/** Returns the problem list as text, one line per problem. */
+	const string& GetReport() const;
+
+	/** Returns a version stamp that goes up every time the problems change. */
+	int GetVersion() const { return Version; }
+
+private:
+	/** One problem, with everything the report needs worked out when it was stored. */
+	struct ProblemEntry
+	{
+		const Node* ProblemNode;
+		Point Position;
+		string Problem;
+	};
+
+	/** Everything known about one function. */
+	struct FunctionEntry
+	{
+		// Used to tell a new function apart from a deleted one that happened to have the same address.
+		weak_ptr<Function> Source;
+		int EmittedVersion = -1;
+
+		// Name and arity, as shown in the report.
+		string Signature;
+		vector<ProblemEntry> Problems;
+	};
+
+	/** Everything known about one node. */
+	struct NodeEntry
+	{
+		// A node created at the address of a deleted one doesn't inherit its problems.
+		weak_ptr<Node> Source;
+		const Function* Owner = nullptr;
+		vector<string> Problems;
+	};
+
+	/** Replaces a function's problems with the ones from its cache. */
+	void StoreFunction(const shared_ptr<Function>& Func, FunctionEntry& Entry);
+
+	/** Removes a function's problems from the node index. */
+	void UnindexFunction(const Function* Func, const FunctionEntry& Entry);
+
+private:
+	unordered_map<const Function*, FunctionEntry> Functions;
+	unordered_map<const Node*, NodeEntry> Nodes;
+
+	// Report order is the order the functions are in, so that's kept too.
+	vector<const Function*> FunctionOrder;
+
+	size_t ProblemCount = 0;
+	int Version = 0;
+
+	mutable string Report;
+	mutable int ReportVersion = -1;
+};
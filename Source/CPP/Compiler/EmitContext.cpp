@@ -0,0 +1,22 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "EmitContext.h"
+
+void EmitContext::BeginClause()
+{
+	Bindings.clear();
+	NextVariable = 1;
+}
+
+string EmitContext::CreateVariableName()
+{
+	string Name;
+
+	do
+	{
+		Name = "V" + to_string(NextVariable++);
+	}
+	while (ReservedNames.find(Name) != ReservedNames.end());
+
+	return Name;
+}
@@ -0,0 +1,52 @@
+// Copyright Chris Sixsmith 2020.
+
+#pragma once
+
+#include "Libs.h"
+#include "CompilationProblem.h"
+#include "ConstantValue.h"
+
+/** A node that was emitted once into a variable, so it can be referenced rather than emitted again. */
+struct EmitBinding
+{
+	/** Variable holding the node's value. */
+	string Variable;
+
+	/** Whether the node emitted without problems. */
+	bool Pass = false;
+};
+
+/**
+ * Emit context.
+ * State shared by every node emitted as part of a function.
+ */
+struct EmitContext
+{
+	EmitContext(vector<CompilationProblem>& ProblemsIn)
+		: Problems(ProblemsIn)
+	{}
+
+	/** Resets per-clause state. Variables are scoped to a clause in Erlang, so every clause starts from scratch. */
+	void BeginClause();
+
+	/** Creates a variable name that isn't used yet in the current clause. */
+	string CreateVariableName();
+
+	/** Problems found while emitting. */
+	vector<CompilationProblem>& Problems;
+
+	/** Names the user has given to variables. Generated variables avoid these. */
+	unordered_set<string> ReservedNames;
+
+	/** Nodes that loop back on themselves. These were reported before emitting started, and emitting stops when it reaches one. */
+	unordered_set<const Node*> CycleNodes;
+
+	/** Nodes already emitted as variable bindings in the current clause. */
+	unordered_map<const Node*, EmitBinding> Bindings;
+
+	/** What every node with arguments evaluated to, so shared subexpressions are only evaluated once. Unknown values are remembered too. */
+	unordered_map<const Node*, ConstantValue> Constants;
+
+private:
+	int NextVariable = 1;
+};
@@ -0,0 +1,141 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "EmitSink.h"
+
+EmitSink::EmitSink(ostream& StreamIn)
+	: Stream(&StreamIn)
+{}
+
+EmitSink::~EmitSink()
+{
+	Flush();
+}
+
+void EmitSink::Append(const char* Data, size_t Length)
+{
+	TotalSize += Length;
+
+	while (Length > 0)
+	{
+		if (Chunks.empty() || Chunks[CurrentChunk].Used == Chunks[CurrentChunk].Capacity)
+		{
+			NextChunk(Length);
+		}
+
+		Chunk& Current = Chunks[CurrentChunk];
+		size_t Count = min(Length, Current.Capacity - Current.Used);
+
+		memcpy(Current.Data.get() + Current.Used, Data, Count);
+
+		Current.Used += Count;
+		Data += Count;
+		Length -= Count;
+	}
+}
+
+void EmitSink::Reserve(size_t Bytes)
+{
+	// Count what's free in the current chunk and any spares.
+	size_t Free = 0;
+
+	for (size_t i = CurrentChunk; i < Chunks.size(); i++)
+	{
+		Free += Chunks[i].Capacity - Chunks[i].Used;
+	}
+
+	if (Free >= Bytes)
+	{
+		return;
+	}
+
+	// Then add a spare big enough for the rest.
+	Chunk Spare;
+	Spare.Capacity = Bytes - Free;
+	Spare.Data = make_unique<char[]>(Spare.Capacity);
+
+	Chunks.push_back(move(Spare));
+}
+
+void EmitSink::Flush()
+{
+	if (!Stream || Chunks.empty())
+	{
+		return;
+	}
+
+	// A streaming sink only ever fills its first chunk.
+	Chunk& Current = Chunks[CurrentChunk];
+
+	Stream->write(Current.Data.get(), Current.Used);
+	Current.Used = 0;
+}
+
+void EmitSink::Clear()
+{
+	for (Chunk& ClearChunk : Chunks)
+	{
+		ClearChunk.Used = 0;
+	}
+
+	CurrentChunk = 0;
+	TotalSize = 0;
+}
+
+void EmitSink::AppendTo(EmitSink& Other) const
+{
+	Other.Reserve(TotalSize);
+
+	ForEachChunk([&Other](const char* Data, size_t Length)
+	{
+		Other.Append(Data, Length);
+	});
+}
+
+string EmitSink::ToString() const
+{
+	string Out;
+	Out.reserve(TotalSize);
+
+	ForEachChunk([&Out](const char* Data, size_t Length)
+	{
+		Out.append(Data, Length);
+	});
+
+	return Out;
+}
+
+void EmitSink::ForEachChunk(const function<void(const char* Data, size_t Length)>& ChunkFunction) const
+{
+	for (size_t i = 0; i <= CurrentChunk && i < Chunks.size(); i++)
+	{
+		if (Chunks[i].Used > 0)
+		{
+			ChunkFunction(Chunks[i].Data.get(), Chunks[i].Used);
+		}
+	}
+}
+
+void EmitSink::NextChunk(size_t MinimumSize)
+{
+	// Streaming sinks write out the full chunk and reuse it.
+	if (Stream && !Chunks.empty())
+	{
+		Flush();
+		return;
+	}
+
+	// Use a spare if there is one...
+	if (!Chunks.empty() && CurrentChunk + 1 < Chunks.size())
+	{
+		CurrentChunk++;
+		return;
+	}
+
+	// ...otherwise make a new chunk. Each one is as big as everything before it, up to a limit, so there are only ever a few small ones.
+	Chunk NewChunk;
+	NewChunk.Capacity = max(MinChunkSize, min(MaxChunkSize, max(TotalSize, MinimumSize)));
+	NewChunk.Data = make_unique<char[]>(NewChunk.Capacity);
+
+	Chunks.push_back(move(NewChunk));
+	CurrentChunk = Chunks.size() - 1;
+}
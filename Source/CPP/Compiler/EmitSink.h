@@ -0,0 +1,82 @@
+// Copyright Chris Sixsmith 2020.
+
+#pragma once
+
+#include "Libs.h"
+
+/**
+ * Emit sink.
+ * Where emitted Erlang code is written to. Text goes into a list of chunks rather than one string, so nothing ever gets moved as the output grows.
+ * - Chunks start small and get bigger as more is written, so a sink holding one short function doesn't cost much.
+ * - Reserve() takes a size hint (i.e. the size of the last emit) and allocates for it all in one go.
+ * - A sink created with a stream writes each chunk out as it fills up, and only ever holds one chunk.
+ */
+class EmitSink
+{
+public:
+	/** Creates a sink that keeps everything written to it in memory. */
+	EmitSink() = default;
+
+	/** Creates a sink that writes straight through to a stream (i.e. an ofstream). The stream must outlive the sink. */
+	explicit EmitSink(ostream& StreamIn);
+
+	/** Writes anything still buffered to the stream, if there is one. */
+	~EmitSink();
+
+	// Moveable, but not copyable - use AppendTo to copy the contents.
+	EmitSink(EmitSink&& Other) = default;
+	EmitSink& operator=(EmitSink&& Other) = default;
+	EmitSink(const EmitSink&) = delete;
+	EmitSink& operator=(const EmitSink&) = delete;
+
+	/** Appends text. */
+	void Append(const char* Data, size_t Length);
+
+	EmitSink& operator+=(const string& Text) { Append(Text.data(), Text.size()); return *this; }
+	EmitSink& operator+=(const char* Text) { Append(Text, strlen(Text)); return *this; }
+	EmitSink& operator+=(char Character) { Append(&Character, 1); return *this; }
+
+	/** Makes sure at least this many more bytes can be appended without allocating. */
+	void Reserve(size_t Bytes);
+
+	/** Returns the total number of bytes written to the sink. */
+	size_t GetSize() const { return TotalSize; }
+
+	/** Writes buffered text to the stream. Does nothing for in-memory sinks. */
+	void Flush();
+
+	/** Removes everything written so far. */
+	void Clear();
+
+	/** Appends everything in this sink to another sink. */
+	void AppendTo(EmitSink& Other) const;
+
+	/** Returns everything in the sink as one string. Only use this when something really needs the text in one piece. */
+	string ToString() const;
+
+	/** Calls a function with each filled chunk in order. */
+	void ForEachChunk(const function<void(const char* Data, size_t Length)>& ChunkFunction) const;
+
+private:
+	/** Moves on to the next chunk, creating one at least MinimumSize bytes big if there isn't a spare one. */
+	void NextChunk(size_t MinimumSize);
+
+private:
+	static constexpr size_t MinChunkSize = 256;
+	static constexpr size_t MaxChunkSize = 64 * 1024;
+
+	struct Chunk
+	{
+		unique_ptr<char[]> Data;
+		size_t Capacity = 0;
+		size_t Used = 0;
+	};
+
+	// Chunks in order. Chunks after CurrentChunk are spare, allocated by Reserve().
+	vector<Chunk> Chunks;
+	size_t CurrentChunk = 0;
+
+	size_t TotalSize = 0;
+
+	ostream* Stream = nullptr;
+};
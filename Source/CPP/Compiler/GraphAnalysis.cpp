@@ -0,0 +1,128 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "GraphAnalysis.h"
+#include "Nodes/Nodes.h"
+
+vector<Node*> FindSharedSubexpressions(Node* Expression)
+{
+	// Walk the expression depth first, counting how many inputs each node feeds.
+	// Nodes are recorded as they finish, which puts everything after its inputs.
+	struct StackEntry
+	{
+		Node* StackNode;
+		int NextArgument;
+	};
+
+	unordered_map<const Node*, int> UseCounts;
+	unordered_set<const Node*> Visited;
+	vector<Node*> Finished;
+	vector<StackEntry> Stack;
+
+	Visited.insert(Expression);
+	Stack.push_back({ Expression, 0 });
+
+	while (!Stack.empty())
+	{
+		StackEntry& Top = Stack.back();
+
+		if (Top.NextArgument < Top.StackNode->GetNumArguments())
+		{
+			Node* Input = Top.StackNode->GetConnector(Top.NextArgument++);
+
+			if (Input)
+			{
+				UseCounts[Input]++;
+
+				if (Visited.insert(Input).second)
+				{
+					Stack.push_back({ Input, 0 });
+				}
+			}
+		}
+		else
+		{
+			Finished.push_back(Top.StackNode);
+			Stack.pop_back();
+		}
+	}
+
+	vector<Node*> Out;
+
+	for (Node* FinishedNode : Finished)
+	{
+		if (UseCounts[FinishedNode] > 1 && FinishedNode->GetNumArguments() > 0)
+		{
+			Out.push_back(FinishedNode);
+		}
+	}
+
+	return Out;
+}
+
+vector<Node*> FindCycles(const vector<shared_ptr<Node>>& StartNodes)
+{
+	// Classic white/grey/black depth first search, done with an explicit stack so long chains can't overflow.
+	// White (not in the map) nodes are unvisited, grey ones are being explored, black ones are done.
+	// Reaching a grey node again means we went round a loop, and every loop gets found this way at least once.
+	enum class Colour
+	{
+		Grey,
+		Black
+	};
+
+	struct StackEntry
+	{
+		Node* StackNode;
+		int NextArgument;
+	};
+
+	unordered_map<const Node*, Colour> Colours;
+	unordered_set<const Node*> Found;
+	vector<Node*> Out;
+	vector<StackEntry> Stack;
+
+	for (const shared_ptr<Node>& Start : StartNodes)
+	{
+		if (!Start || Colours.find(Start.get()) != Colours.end())
+		{
+			continue;
+		}
+
+		Colours[Start.get()] = Colour::Grey;
+		Stack.push_back({ Start.get(), 0 });
+
+		while (!Stack.empty())
+		{
+			StackEntry& Top = Stack.back();
+
+			if (Top.NextArgument < Top.StackNode->GetNumArguments())
+			{
+				Node* Input = Top.StackNode->GetConnector(Top.NextArgument++);
+
+				if (!Input)
+				{
+					continue;
+				}
+
+				auto InputColour = Colours.find(Input);
+
+				if (InputColour == Colours.end())
+				{
+					Colours[Input] = Colour::Grey;
+					Stack.push_back({ Input, 0 });
+				}
+				else if (InputColour->second == Colour::Grey && Found.insert(Input).second)
+				{
+					Out.push_back(Input);
+				}
+			}
+			else
+			{
+				Colours[Top.StackNode] = Colour::Black;
+				Stack.pop_back();
+			}
+		}
+	}
+
+	return Out;
+}
@@ -0,0 +1,19 @@
+// Copyright Chris Sixsmith 2020.
+
+#pragma once
+
+#include "Libs.h"
+
+class Node;
+
+/**
+ * Finds every node within an expression that feeds more than one input, in dependency order (a node always comes after the shared nodes it uses).
+ * Nodes without arguments are left out, since referencing them is no cheaper than emitting them again.
+ */
+vector<Node*> FindSharedSubexpressions(Node* Expression);
+
+/**
+ * Finds every cycle reachable from the given nodes, visiting each node and connector once.
+ * Returns at least one node from every cycle (each is the node the cycle loops back to), in the order they were found.
+ */
+vector<Node*> FindCycles(const vector<shared_ptr<Node>>& StartNodes);
@@ -0,0 +1,121 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "JobPool.h"
+
+JobPool::JobPool(int ThreadCount)
+{
+#if !IS_WEB
+	for (int i = 0; i < ThreadCount; i++)
+	{
+		Threads.push_back(thread(&JobPool::ThreadLoop, this));
+	}
+#endif
+}
+
+JobPool::~JobPool()
+{
+#if !IS_WEB
+	{
+		lock_guard<mutex> Lock(Mutex);
+		Stopping = true;
+	}
+
+	BatchStarted.notify_all();
+
+	for (thread& PoolThread : Threads)
+	{
+		PoolThread.join();
+	}
+#endif
+}
+
+void JobPool::Run(size_t Count, const function<void(size_t Index)>& JobFunction)
+{
+	// Not worth waking anyone for a single job.
+	if (Threads.empty() || Count <= 1)
+	{
+		for (size_t i = 0; i < Count; i++)
+		{
+			JobFunction(i);
+		}
+
+		return;
+	}
+
+#if !IS_WEB
+	lock_guard<mutex> RunLock(RunMutex);
+
+	{
+		lock_guard<mutex> Lock(Mutex);
+
+		Job = &JobFunction;
+		JobCount = Count;
+		NextJob = 0;
+		JobsDone = 0;
+		Batch++;
+	}
+
+	BatchStarted.notify_all();
+
+	RunJobs();
+
+	// Other threads may still be finishing the last few jobs.
+	unique_lock<mutex> Lock(Mutex);
+	BatchFinished.wait(Lock, [this] { return JobsDone == JobCount; });
+
+	Job = nullptr;
+#endif
+}
+
+int JobPool::GetDefaultThreadCount()
+{
+	// hardware_concurrency() is allowed to return 0 if it doesn't know.
+	return max(1, (int)thread::hardware_concurrency()) - 1;
+}
+
+void JobPool::ThreadLoop()
+{
+#if !IS_WEB
+	int SeenBatch = 0;
+
+	while (true)
+	{
+		{
+			unique_lock<mutex> Lock(Mutex);
+			BatchStarted.wait(Lock, [this, SeenBatch] { return Batch != SeenBatch || Stopping; });
+
+			if (Stopping)
+			{
+				return;
+			}
+
+			SeenBatch = Batch;
+		}
+
+		RunJobs();
+	}
+#endif
+}
+
+void JobPool::RunJobs()
+{
+#if !IS_WEB
+	unique_lock<mutex> Lock(Mutex);
+
+	// A thread that wakes up late finds every job already claimed, and goes straight back to sleep.
+	while (Job && NextJob < JobCount)
+	{
+		const function<void(size_t Index)>* CurrentJob = Job;
+		size_t Index = NextJob++;
+
+		Lock.unlock();
+		(*CurrentJob)(Index);
+		Lock.lock();
+
+		if (++JobsDone == JobCount)
+		{
+			BatchFinished.notify_all();
+		}
+	}
+#endif
+}
@@ -0,0 +1,61 @@
+// Copyright Chris Sixsmith 2020.
+
+#pragma once
+
+#include "Libs.h"
+
+/**
+ * Job pool.
+ * A fixed set of threads that share out a batch of independent jobs.
+ * - Run() hands out job indices one at a time until every job has been claimed, and the calling thread works through them too.
+ * - A batch is finished when Run() returns. Only one batch runs at a time.
+ * - Without threads (i.e. the web build) every job runs on the calling thread.
+ */
+class JobPool
+{
+public:
+	/** Creates a pool with ThreadCount threads on top of the one calling Run(). Zero means jobs always run on the caller. */
+	explicit JobPool(int ThreadCount);
+	~JobPool();
+
+	// Non copyable!
+	JobPool(const JobPool&) = delete;
+	JobPool& operator=(const JobPool&) = delete;
+
+	/** Calls JobFunction once for every index from 0 to Count - 1, spread over the pool. Returns when every call has returned. */
+	void Run(size_t Count, const function<void(size_t Index)>& JobFunction);
+
+	/** Returns how many threads the pool has, not counting the caller. */
+	int GetThreadCount() const { return (int)Threads.size(); }
+
+	/** Returns a thread count that uses every core alongside the calling thread. */
+	static int GetDefaultThreadCount();
+
+private:
+	/** Pool thread body. */
+	void ThreadLoop();
+
+	/** Claims and runs jobs from the current batch until none are left. */
+	void RunJobs();
+
+private:
+	// Held for the whole of Run(), so batches never overlap.
+	mutex RunMutex;
+
+	mutex Mutex;
+
+	// The current batch. Job is null between batches.
+	const function<void(size_t Index)>* Job = nullptr;
+	size_t JobCount = 0;
+	size_t NextJob = 0;
+	size_t JobsDone = 0;
+	int Batch = 0;
+
+	vector<thread> Threads;
+
+#if !IS_WEB
+	condition_variable BatchStarted;
+	condition_variable BatchFinished;
+	bool Stopping = false;
+#endif
+};
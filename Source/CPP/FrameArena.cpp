@@ -0,0 +1,62 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "FrameArena.h"
+
+FrameArena::FrameArena(size_t BlockSizeIn)
+	: BlockSize(BlockSizeIn)
+{
+	AddBlock(BlockSize);
+}
+
+void* FrameArena::Allocate(size_t Bytes, size_t Alignment)
+{
+	// Blocks come from new[], so they start aligned for anything up to max_align_t.
+	assert(Alignment > 0 && Alignment <= alignof(max_align_t) && (Alignment & (Alignment - 1)) == 0);
+
+	size_t Start = (Offset + Alignment - 1) & ~(Alignment - 1);
+
+	if (Start + Bytes > Blocks[CurrentBlock].Size)
+	{
+		// Move on to the next block, adding one if there isn't one big enough.
+		CurrentBlock++;
+
+		if (CurrentBlock == Blocks.size() || Blocks[CurrentBlock].Size < Bytes)
+		{
+			AddBlock(Bytes);
+		}
+
+		Start = 0;
+	}
+
+	Offset = Start + Bytes;
+	BytesUsed += Bytes;
+
+	return Blocks[CurrentBlock].Memory.get() + Start;
+}
+
+void FrameArena::Reset()
+{
+	BytesUsedPeak = max(BytesUsedPeak, BytesUsed);
+
+	// Replace the blocks with one that would have fit everything, so the same frame next time doesn't need more than one.
+	if (Blocks.size() > 1)
+	{
+		Blocks.clear();
+		AddBlock(max(BlockSize, BytesUsedPeak * 2));
+
+		BytesUsedPeak = 0;
+	}
+
+	CurrentBlock = 0;
+	Offset = 0;
+	BytesUsed = 0;
+}
+
+void FrameArena::AddBlock(size_t MinimumSize)
+{
+	Block NewBlock;
+	NewBlock.Size = max(BlockSize, MinimumSize);
+	NewBlock.Memory = make_unique<char[]>(NewBlock.Size);
+
+	Blocks.insert(Blocks.begin() + min(CurrentBlock, Blocks.size()), move(NewBlock));
+}
@@ -0,0 +1,95 @@
+// Copyright Chris Sixsmith 2020.
+
+#pragma once
+
+#include "Libs.h"
+
+/**
+ * Frame arena.
+ * A bump allocator for things that only live until the end of the frame (i.e. tooltip text). Everything in it is thrown away at once by Reset().
+ * - Allocating just moves an offset along the current block. Freeing does nothing.
+ * - If a frame needs more than one block, the blocks are replaced with one big enough for all of it on the next Reset, so a steady stream of similar frames stops allocating.
+ */
+class FrameArena
+{
+public:
+	explicit FrameArena(size_t BlockSizeIn = 16 * 1024);
+
+	// Non copyable!
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	/** Returns memory for the given number of bytes, aligned as asked. Valid until the next Reset. */
+	void* Allocate(size_t Bytes, size_t Alignment);
+
+	/** Throws away everything allocated since the last Reset. */
+	void Reset();
+
+	/** Returns the number of bytes handed out since the last Reset. */
+	size_t GetBytesUsed() const { return BytesUsed; }
+
+private:
+	struct Block
+	{
+		unique_ptr<char[]> Memory;
+		size_t Size = 0;
+	};
+
+	/** Adds a block with room for at least the given number of bytes, and makes it current. */
+	void AddBlock(size_t MinimumSize);
+
+private:
+	size_t BlockSize;
+
+	vector<Block> Blocks;
+	size_t CurrentBlock = 0;
+	size_t Offset = 0;
+
+	size_t BytesUsed = 0;
+	size_t BytesUsedPeak = 0; // the most used in a single frame, since the blocks were last merged
+};
+
+/** Standard allocator that takes its memory from a frame arena, for use with the standard containers. Deallocating does nothing. */
+template<class T>
+class FrameAllocator
+{
+public:
+	using value_type = T;
+
+	FrameAllocator(FrameArena& ArenaIn) : Arena(&ArenaIn) {}
+
+	template<class U>
+	FrameAllocator(const FrameAllocator<U>& Other) : Arena(Other.GetArena()) {}
+
+	T* allocate(size_t Count) { return static_cast<T*>(Arena->Allocate(Count * sizeof(T), alignof(T))); }
+	void deallocate(T* Pointer, size_t Count) {}
+
+	FrameArena* GetArena() const { return Arena; }
+
+	template<class U>
+	bool operator==(const FrameAllocator<U>& Other) const { return Arena == Other.GetArena(); }
+
+	template<class U>
+	bool operator!=(const FrameAllocator<U>& Other) const { return Arena != Other.GetArena(); }
+
+private:
+	FrameArena* Arena;
+};
+
+/** A string that lives in a frame arena. Don't keep it past the end of the frame! */
+using FrameString = basic_string<char, char_traits<char>, FrameAllocator<char>>;
+
+/** A vector that lives in a frame arena. Don't keep it past the end of the frame! */
+template<class T>
+using FrameVector = vector<T, FrameAllocator<T>>;
+
+/** Appends an integer to a string, without the temporary string to_string would make. */
+template<class StringType>
+StringType& AppendInt(StringType& Out, int Value)
+{
+	char Buffer[16];
+	to_chars_result Result = to_chars(Buffer, Buffer + sizeof(Buffer), Value);
+	Out.append(Buffer, Result.ptr);
+
+	return Out;
+}
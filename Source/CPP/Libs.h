@@ -2,6 +2,11 @@
 
 // Includes libraries.
 
+// Headless builds (i.e. the command line compiler) only contain the program model and compiler, so they don't need SDL.
+#ifndef IS_HEADLESS
+#define IS_HEADLESS 0
+#endif
+
 #if IS_WEB
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
@@ -9,7 +14,7 @@
 #include <emscripten.h>
 #include <emscripten/html5.h>
 #include <unistd.h>
-#else
+#elif !IS_HEADLESS
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_ttf.h>
@@ -17,13 +22,25 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
+#include <deque>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <cassert>
 #include <memory>
 #include <filesystem>
 #include <algorithm>
 #include <functional>
+#include <typeindex>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <charconv>
+#include <string_view>
 
 using namespace std;
\ No newline at end of file
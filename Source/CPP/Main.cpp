@@ -0,0 +1,20 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "Alchemist.h"
+
+int main(int argc, char* argv[])
+{
+	printf("Log statements work\n");
+	
+	Alchemist AlchemistInstance = Alchemist();
+
+	// A project to open can be given on the command line.
+	if (argc > 1)
+	{
+		AlchemistInstance.OpenProject(argv[1]);
+	}
+
+	AlchemistInstance.Run();
+
+	return 0;
+}
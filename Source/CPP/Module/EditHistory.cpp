@@ -0,0 +1,582 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "EditHistory.h"
+#include "Function.h"
+#include "Module.h"
+
+#include "Nodes/Special/Node_Root.h"
+#include "Nodes/Special/Node_UserDefined.h"
+
+/** One connector, held by the nodes at each end rather than by handle, so it can be put back after either node has been removed and placed again. */
+struct SavedConnector
+{
+	shared_ptr<Node> Target;
+	int Argument = 0;
+	shared_ptr<Node> From;
+};
+
+/** Returns a reference to a node, or null. */
+static shared_ptr<Node> LockNode(Node* NodeInstance)
+{
+	return NodeInstance ? NodeInstance->shared_from_this() : nullptr;
+}
+
+/** Adds every connector of the node to the list. */
+static void SaveInputs(const shared_ptr<Node>& Target, vector<SavedConnector>& Out)
+{
+	for (int i = 0; i < Target->GetNumArguments(); i++)
+	{
+		if (Node* From = Target->GetConnector(i))
+		{
+			Out.push_back(SavedConnector{ Target, i, LockNode(From) });
+		}
+	}
+}
+
+/** Adds every connector pointing at the node to the list. */
+static void SaveConsumers(const Function& Func, const shared_ptr<Node>& From, vector<SavedConnector>& Out)
+{
+	for (const NodeConsumer& Consumer : From->GetConsumers())
+	{
+		Out.push_back(SavedConnector{ LockNode(Func.GetNode(Consumer.Consumer)), Consumer.Argument, From });
+	}
+}
+
+/** Puts saved connectors back. Ones whose argument doesn't exist anymore are skipped. */
+static void RestoreConnectors(const vector<SavedConnector>& Connectors)
+{
+	for (const SavedConnector& Connector : Connectors)
+	{
+		if (Connector.Argument < Connector.Target->GetNumArguments())
+		{
+			Connector.Target->SetConnector(Connector.From.get(), Connector.Argument);
+		}
+	}
+}
+
+/** Returns the node's data packet (see Node::Save). */
+static string SaveNodeData(const Node& Target)
+{
+	ostringstream Stream(ios::out | ios::binary);
+	Target.Save(Stream);
+
+	return Stream.str();
+}
+
+/** Loads a data packet from SaveNodeData back into the node. */
+static void LoadNodeData(Node& Target, const string& Data)
+{
+	istringstream Stream(Data, ios::in | ios::binary);
+	Target.Load(Stream);
+}
+
+
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+
+
+/** A node was added to a function. */
+class PlaceNodeCommand : public EditCommand
+{
+public:
+	PlaceNodeCommand(const shared_ptr<Function>& FuncIn, const shared_ptr<Node>& PlacedNodeIn, const Point& PositionIn)
+		: EditCommand(FuncIn), PlacedNode(PlacedNodeIn), Position(PositionIn)
+	{
+		// A copy of a node keeps its inputs.
+		SaveInputs(PlacedNode, Inputs);
+	}
+
+	virtual void Undo() override
+	{
+		Func->RemoveNode(PlacedNode);
+	}
+
+	virtual void Redo() override
+	{
+		Func->PlaceNode(PlacedNode, Position);
+		RestoreConnectors(Inputs);
+	}
+
+private:
+	shared_ptr<Node> PlacedNode;
+	Point Position;
+	vector<SavedConnector> Inputs;
+};
+
+/** A node was removed from a function. Nothing else was connected to it afterwards, so taking it back only needs the connectors it had then. */
+class RemoveNodeCommand : public EditCommand
+{
+public:
+	RemoveNodeCommand(const shared_ptr<Function>& FuncIn, const shared_ptr<Node>& RemovedNodeIn)
+		: EditCommand(FuncIn), RemovedNode(RemovedNodeIn), Position(RemovedNodeIn->GetGridPosition())
+	{
+		SaveInputs(RemovedNode, Connectors);
+		SaveConsumers(*Func, RemovedNode, Connectors);
+	}
+
+	virtual void Undo() override
+	{
+		Func->PlaceNode(RemovedNode, Position);
+		RestoreConnectors(Connectors);
+	}
+
+	virtual void Redo() override
+	{
+		Func->RemoveNode(RemovedNode);
+	}
+
+private:
+	shared_ptr<Node> RemovedNode;
+	Point Position;
+	vector<SavedConnector> Connectors;
+};
+
+/** A node was moved to another grid position. */
+class MoveNodeCommand : public EditCommand
+{
+public:
+	MoveNodeCommand(const shared_ptr<Function>& FuncIn, const shared_ptr<Node>& MovedNodeIn, const Point& FromIn, const Point& ToIn)
+		: EditCommand(FuncIn), MovedNode(MovedNodeIn), From(FromIn), To(ToIn)
+	{}
+
+	virtual void Undo() override
+	{
+		Func->PlaceNode(MovedNode, From);
+	}
+
+	virtual void Redo() override
+	{
+		Func->PlaceNode(MovedNode, To);
+	}
+
+	virtual bool Merge(const EditCommand& Next) override
+	{
+		const MoveNodeCommand* NextMove = dynamic_cast<const MoveNodeCommand*>(&Next);
+
+		if (!NextMove || NextMove->MovedNode != MovedNode)
+		{
+			return false;
+		}
+
+		To = NextMove->To;
+		return true;
+	}
+
+	virtual bool IsEmpty() const override
+	{
+		return From == To;
+	}
+
+private:
+	shared_ptr<Node> MovedNode;
+	Point From;
+	Point To;
+};
+
+/** A connector was made, changed or broken. */
+class SetConnectorCommand : public EditCommand
+{
+public:
+	SetConnectorCommand(const shared_ptr<Function>& FuncIn, const shared_ptr<Node>& TargetIn, int ArgumentIn, const shared_ptr<Node>& OldFromIn, const shared_ptr<Node>& NewFromIn)
+		: EditCommand(FuncIn), Target(TargetIn), Argument(ArgumentIn), OldFrom(OldFromIn), NewFrom(NewFromIn)
+	{}
+
+	virtual void Undo() override
+	{
+		Target->SetConnector(OldFrom.get(), Argument);
+	}
+
+	virtual void Redo() override
+	{
+		Target->SetConnector(NewFrom.get(), Argument);
+	}
+
+	virtual bool Merge(const EditCommand& Next) override
+	{
+		const SetConnectorCommand* NextConnect = dynamic_cast<const SetConnectorCommand*>(&Next);
+
+		if (!NextConnect || NextConnect->Target != Target || NextConnect->Argument != Argument)
+		{
+			return false;
+		}
+
+		NewFrom = NextConnect->NewFrom;
+		return true;
+	}
+
+	virtual bool IsEmpty() const override
+	{
+		return OldFrom == NewFrom;
+	}
+
+private:
+	shared_ptr<Node> Target;
+	int Argument;
+	shared_ptr<Node> OldFrom;
+	shared_ptr<Node> NewFrom;
+};
+
+/** A node's own data (i.e. a term's value or a variable's name) was changed. */
+class EditNodeCommand : public EditCommand
+{
+public:
+	EditNodeCommand(const shared_ptr<Function>& FuncIn, const shared_ptr<Node>& TargetIn, string BeforeIn, string AfterIn)
+		: EditCommand(FuncIn), Target(TargetIn), Before(move(BeforeIn)), After(move(AfterIn))
+	{}
+
+	virtual void Undo() override
+	{
+		LoadNodeData(*Target, Before);
+	}
+
+	virtual void Redo() override
+	{
+		LoadNodeData(*Target, After);
+	}
+
+	virtual bool Merge(const EditCommand& Next) override
+	{
+		const EditNodeCommand* NextEdit = dynamic_cast<const EditNodeCommand*>(&Next);
+
+		if (!NextEdit || NextEdit->Target != Target)
+		{
+			return false;
+		}
+
+		After = NextEdit->After;
+		return true;
+	}
+
+	virtual bool IsEmpty() const override
+	{
+		return Before == After;
+	}
+
+private:
+	shared_ptr<Node> Target;
+	string Before;
+	string After;
+};
+
+/** A function was renamed. */
+class RenameCommand : public EditCommand
+{
+public:
+	RenameCommand(const shared_ptr<Function>& FuncIn, string OldNameIn, string NewNameIn)
+		: EditCommand(FuncIn), OldName(move(OldNameIn)), NewName(move(NewNameIn))
+	{}
+
+	virtual void Undo() override
+	{
+		Func->Rename(OldName);
+	}
+
+	virtual void Redo() override
+	{
+		Func->Rename(NewName);
+	}
+
+	virtual bool Merge(const EditCommand& Next) override
+	{
+		const RenameCommand* NextRename = dynamic_cast<const RenameCommand*>(&Next);
+
+		if (!NextRename || NextRename->Func != Func)
+		{
+			return false;
+		}
+
+		NewName = NextRename->NewName;
+		return true;
+	}
+
+	virtual bool IsEmpty() const override
+	{
+		return OldName == NewName;
+	}
+
+	virtual bool CanUndo() const override
+	{
+		return IsNameFree(OldName);
+	}
+
+	virtual bool CanRedo() const override
+	{
+		return IsNameFree(NewName);
+	}
+
+private:
+	/** Returns true if the function can take the name (renaming fails if another function already has it). */
+	bool IsNameFree(const string& Name) const
+	{
+		shared_ptr<Function> Existing = Func->GetModule()->GetFunction(Name);
+		return !Existing || Existing == Func;
+	}
+
+private:
+	string OldName;
+	string NewName;
+};
+
+/**
+ * A function's arity was changed.
+ * Lowering it takes arguments away from its root nodes and the nodes calling it, along with their connectors, so those are kept to be put back.
+ */
+class SetArityCommand : public EditCommand
+{
+public:
+	SetArityCommand(const shared_ptr<Function>& FuncIn, int OldArityIn, int NewArityIn, vector<SavedConnector> ConnectorsIn)
+		: EditCommand(FuncIn), OldArity(OldArityIn), NewArity(NewArityIn), Connectors(move(ConnectorsIn))
+	{}
+
+	virtual void Undo() override
+	{
+		Func->SetArity(OldArity);
+		RestoreConnectors(Connectors);
+	}
+
+	virtual void Redo() override
+	{
+		Func->SetArity(NewArity);
+	}
+
+	virtual bool Merge(const EditCommand& Next) override
+	{
+		const SetArityCommand* NextArity = dynamic_cast<const SetArityCommand*>(&Next);
+
+		if (!NextArity || NextArity->Func != Func)
+		{
+			return false;
+		}
+
+		// Our connectors were saved first, so they're the ones to go back to.
+		NewArity = NextArity->NewArity;
+		return true;
+	}
+
+private:
+	int OldArity;
+	int NewArity;
+	vector<SavedConnector> Connectors;
+};
+
+
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+
+
+bool EditHistory::PlaceNode(const shared_ptr<Function>& Func, const shared_ptr<Node>& NewNode, const Point& Position)
+{
+	bool WasPlaced = Func->GetNodeHandle(NewNode).IsValid();
+	Point From = NewNode->GetGridPosition();
+
+	if (!Func->PlaceNode(NewNode, Position))
+	{
+		return false;
+	}
+
+	if (!WasPlaced)
+	{
+		Record(make_unique<PlaceNodeCommand>(Func, NewNode, Position));
+	}
+	else if (From != Position)
+	{
+		Record(make_unique<MoveNodeCommand>(Func, NewNode, From, Position));
+	}
+
+	return true;
+}
+
+void EditHistory::RemoveNode(const shared_ptr<Function>& Func, const shared_ptr<Node>& RemovedNode)
+{
+	if (!Func->GetNodeHandle(RemovedNode).IsValid())
+	{
+		return;
+	}
+
+	// Save the connectors before removing the node breaks them.
+	unique_ptr<EditCommand> Command = make_unique<RemoveNodeCommand>(Func, RemovedNode);
+
+	Func->RemoveNode(RemovedNode);
+
+	Record(move(Command));
+}
+
+bool EditHistory::SetConnector(const shared_ptr<Function>& Func, const shared_ptr<Node>& Target, const shared_ptr<Node>& From, int Argument)
+{
+	shared_ptr<Node> OldFrom = LockNode(Target->GetConnector(Argument));
+
+	if (!Target->SetConnector(From.get(), Argument))
+	{
+		return false;
+	}
+
+	if (OldFrom != From)
+	{
+		Record(make_unique<SetConnectorCommand>(Func, Target, Argument, OldFrom, From));
+	}
+
+	return true;
+}
+
+void EditHistory::EditNode(const shared_ptr<Function>& Func, const shared_ptr<Node>& Target, const function<void()>& Edit)
+{
+	string Before = SaveNodeData(*Target);
+
+	Edit();
+
+	string After = SaveNodeData(*Target);
+
+	if (After != Before)
+	{
+		Record(make_unique<EditNodeCommand>(Func, Target, move(Before), move(After)));
+	}
+}
+
+void EditHistory::Rename(const shared_ptr<Function>& Func, const string& NewName)
+{
+	string OldName = Func->GetName();
+
+	// Renaming fails if another function already has the name.
+	Func->Rename(NewName);
+
+	if (Func->GetName() != OldName)
+	{
+		Record(make_unique<RenameCommand>(Func, OldName, Func->GetName()));
+	}
+}
+
+void EditHistory::SetArity(const shared_ptr<Function>& Func, int NewArity)
+{
+	int OldArity = Func->GetArity();
+
+	if (NewArity == OldArity)
+	{
+		return;
+	}
+
+	// Save the connectors of every node whose arguments depend on the arity.
+	vector<SavedConnector> Connectors;
+
+	for (const shared_ptr<Node_Root>& Root : Func->GetNodesOfClass<Node_Root>())
+	{
+		SaveInputs(Root, Connectors);
+	}
+
+	for (Node_UserDefined* Call : Func->GetModule()->GetCallSites(Func.get()))
+	{
+		SaveInputs(Call->shared_from_this(), Connectors);
+	}
+
+	Func->SetArity(NewArity);
+
+	Record(make_unique<SetArityCommand>(Func, OldArity, NewArity, move(Connectors)));
+}
+
+shared_ptr<Function> EditHistory::Undo()
+{
+	if (UndoSteps.empty())
+	{
+		return nullptr;
+	}
+
+	// Take back all of the step or none of it, so the history never disagrees with the program.
+	for (const unique_ptr<EditCommand>& Command : UndoSteps.back())
+	{
+		if (!Command->CanUndo())
+		{
+			return nullptr;
+		}
+	}
+
+	Step Undone = move(UndoSteps.back());
+	UndoSteps.pop_back();
+
+	for (auto Command = Undone.rbegin(); Command != Undone.rend(); ++Command)
+	{
+		(*Command)->Undo();
+	}
+
+	shared_ptr<Function> Func = Undone.front()->GetFunction();
+	RedoSteps.push_back(move(Undone));
+
+	// Whatever happens next is a step of its own.
+	GestureStarted = true;
+
+	return Func;
+}
+
+shared_ptr<Function> EditHistory::Redo()
+{
+	if (RedoSteps.empty())
+	{
+		return nullptr;
+	}
+
+	for (const unique_ptr<EditCommand>& Command : RedoSteps.back())
+	{
+		if (!Command->CanRedo())
+		{
+			return nullptr;
+		}
+	}
+
+	Step Redone = move(RedoSteps.back());
+	RedoSteps.pop_back();
+
+	for (const unique_ptr<EditCommand>& Command : Redone)
+	{
+		Command->Redo();
+	}
+
+	shared_ptr<Function> Func = Redone.front()->GetFunction();
+	UndoSteps.push_back(move(Redone));
+
+	GestureStarted = true;
+
+	return Func;
+}
+
+void EditHistory::Clear()
+{
+	UndoSteps.clear();
+	RedoSteps.clear();
+	GestureStarted = true;
+}
+
+void EditHistory::Record(unique_ptr<EditCommand> Command)
+{
+	// A new change replaces anything that was undone.
+	RedoSteps.clear();
+
+	if (GestureStarted || UndoSteps.empty())
+	{
+		UndoSteps.emplace_back();
+		GestureStarted = false;
+
+		if (UndoSteps.size() > MaxSteps)
+		{
+			UndoSteps.pop_front();
+		}
+	}
+
+	Step& Current = UndoSteps.back();
+
+	if (!Current.empty() && Current.back()->Merge(*Command))
+	{
+		// The later change took the earlier one back, so there's nothing left to undo.
+		if (Current.back()->IsEmpty())
+		{
+			Current.pop_back();
+
+			if (Current.empty())
+			{
+				UndoSteps.pop_back();
+				GestureStarted = true;
+			}
+		}
+
+		return;
+	}
+
+	Current.push_back(move(Command));
+}
@@ -0,0 +1,119 @@
+// Copyright Chris Sixsmith 2020.
+
+#pragma once
+
+#include "Libs.h"
+#include "2DPositioning.h"
+
+class Function;
+class Node;
+
+/**
+ * Edit command.
+ * One change to the program, which knows how to take itself back and do itself again.
+ * Commands only remember what they changed (a node, a connector, a name), so their cost never depends on the size of the function.
+ */
+class EditCommand
+{
+public:
+	EditCommand(const shared_ptr<Function>& FuncIn) : Func(FuncIn) {}
+	virtual ~EditCommand() = default;
+
+	/** Takes the change back. The program must be as it was right after the change. */
+	virtual void Undo() = 0;
+
+	/** Makes the change again. The program must be as it was right before the change. */
+	virtual void Redo() = 0;
+
+	/** Folds a later change into this one if they change the same thing (i.e. typing into a node), so both are taken back together. Returns false if they can't be. */
+	virtual bool Merge(const EditCommand& Next) { return false; }
+
+	/** Returns true if merging has left the command changing nothing (i.e. a name typed and then backspaced), so it can be dropped. */
+	virtual bool IsEmpty() const { return false; }
+
+	/** Returns false if the change can't be taken back as things are (i.e. another function has since taken the name it would go back to). */
+	virtual bool CanUndo() const { return true; }
+
+	/** Returns false if the change can't be made again as things are. */
+	virtual bool CanRedo() const { return true; }
+
+	/** Returns the function the change was made in. */
+	const shared_ptr<Function>& GetFunction() const { return Func; }
+
+protected:
+	shared_ptr<Function> Func;
+};
+
+/**
+ * Edit history.
+ * Makes changes to the program on the editor's behalf and keeps a log of them, so they can be undone and redone.
+ * - Changes are grouped into steps, one per gesture (i.e. a click or drag, and whatever is typed before the next one). Undo and redo go a step at a time.
+ * - Repeated changes to the same thing in one step are merged, so typing a long number is one command rather than one per key.
+ * - Steps hold on to the nodes they removed rather than copies of the function, so memory only grows with the number and size of the edits.
+ */
+class EditHistory
+{
+public:
+	EditHistory() = default;
+
+	// Non copyable!
+	EditHistory(const EditHistory&) = delete;
+	EditHistory& operator=(const EditHistory&) = delete;
+
+	/** Starts a new gesture. Changes made after this are undone separately from the ones before. */
+	void BeginGesture() { GestureStarted = true; }
+
+	/** Places a node in a function, or moves it if it's already there. Returns false if something was in the way. */
+	bool PlaceNode(const shared_ptr<Function>& Func, const shared_ptr<Node>& NewNode, const Point& Position);
+
+	/** Removes a node from a function, along with every connector to and from it. */
+	void RemoveNode(const shared_ptr<Function>& Func, const shared_ptr<Node>& RemovedNode);
+
+	/** Sets one of a node's connectors. Passing null disconnects it. Returns false if the connection isn't allowed. */
+	bool SetConnector(const shared_ptr<Function>& Func, const shared_ptr<Node>& Target, const shared_ptr<Node>& From, int Argument);
+
+	/** Runs something that changes a node's own data (i.e. a term's value), keeping what the data was before and after. */
+	void EditNode(const shared_ptr<Function>& Func, const shared_ptr<Node>& Target, const function<void()>& Edit);
+
+	/** Renames a function. */
+	void Rename(const shared_ptr<Function>& Func, const string& NewName);
+
+	/** Changes a function's arity. */
+	void SetArity(const shared_ptr<Function>& Func, int NewArity);
+
+	/**
+	 * Takes back the last step. Returns the function it was made in, or null if there was nothing to undo.
+	 * Also returns null if any of the step can't be taken back, in which case none of it is and it stays the next step to undo.
+	 */
+	shared_ptr<Function> Undo();
+
+	/**
+	 * Makes the last undone step again. Returns the function it was made in, or null if there was nothing to redo.
+	 * Also returns null if any of the step can't be made again, in which case none of it is and it stays the next step to redo.
+	 */
+	shared_ptr<Function> Redo();
+
+	/** Returns true if there's a step to undo. */
+	bool CanUndo() const { return !UndoSteps.empty(); }
+
+	/** Returns true if there's a step to redo. */
+	bool CanRedo() const { return !RedoSteps.empty(); }
+
+	/** Forgets every step. Call this when the program is changed some other way (i.e. loaded, or a function was deleted). */
+	void Clear();
+
+public:
+	/** The oldest steps are forgotten past this many. */
+	static constexpr size_t MaxSteps = 1000;
+
+private:
+	typedef vector<unique_ptr<EditCommand>> Step;
+
+	/** Adds a change that has just been made to the log. */
+	void Record(unique_ptr<EditCommand> Command);
+
+private:
+	deque<Step> UndoSteps;
+	vector<Step> RedoSteps;
+	bool GestureStarted = true;
+};
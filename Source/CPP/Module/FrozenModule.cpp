@@ -0,0 +1,15 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "FrozenModule.h"
+
+CompilationProblem FrozenFunction::ToSource(const CompilationProblem& Problem) const
+{
+	auto Found = SourceNodes.find(Problem.ProblemNode.lock().get());
+
+	if (Found != SourceNodes.end())
+	{
+		return CompilationProblem{ Found->second, Problem.Problem };
+	}
+
+	return Problem;
+}
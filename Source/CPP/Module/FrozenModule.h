@@ -0,0 +1,72 @@
+// Copyright Chris Sixsmith 2020.
+
+#pragma once
+
+#include "Libs.h"
+#include "CompilationProblem.h"
+
+class Module;
+class Function;
+class Node;
+
+/**
+ * Frozen function.
+ * An immutable copy of one version of a function. Nothing changes it once it's made, so any number of threads can read it at once without locking.
+ * Made by copying every node of the live function, so it costs O(nodes in the function). A function keeps handing out the same copy until it changes, so only edited functions pay that again.
+ */
+struct FrozenFunction
+{
+	/** The live function's version when the copy was made. */
+	int Version = 0;
+
+	/** The copy, with every node and connector. */
+	shared_ptr<const Function> Copy;
+
+	/** The signatures of the functions the copy calls. Kept here so calls in the copy always have something to point at. */
+	vector<shared_ptr<const Function>> Callees;
+
+	/** Maps copied nodes to the live nodes they came from. */
+	unordered_map<const Node*, weak_ptr<Node>> SourceNodes;
+
+	/** Converts a problem found in the copy into one pointing at the live node. */
+	CompilationProblem ToSource(const CompilationProblem& Problem) const;
+};
+
+/** One function in a frozen module. */
+struct FrozenModuleEntry
+{
+	/** The live function the copy was made from. */
+	weak_ptr<Function> Source;
+
+	/** The live function's version when the module was frozen. */
+	int Version = 0;
+
+	/** The function as it was. Shared with every other frozen module made while the function stayed the same. */
+	shared_ptr<const FrozenFunction> Frozen;
+
+	/** Whether the live function had changed since it was last emitted, i.e. whether a compile needs to emit it. */
+	bool NeedsEmit = false;
+
+	/** How much code the live function emitted last time. Used to size the output buffer up front. */
+	size_t CodeSizeHint = 0;
+};
+
+/**
+ * Frozen module.
+ * An immutable copy of the whole program at one version, for anything that reads it while the user keeps editing the live module (i.e. compiling on another thread).
+ * - Every function is in it, in module order. Frozen functions are shared between frozen modules until they change (see Module::Freeze for the cost).
+ * - Sharing is per function, not per node: editing one node of a function means the next freeze copies the whole function again.
+ * - Nothing in a frozen module is ever changed, so readers don't need locks.
+ * - Problems found in its functions can be traced back to the live nodes they were copied from.
+ */
+struct FrozenModule
+{
+	/** The live module's version when it was frozen. */
+	int ModuleVersion = 0;
+
+	/** The live module's name. */
+	string Name;
+
+	/** Every function, in module order. */
+	vector<FrozenModuleEntry> Functions;
+};
@@ -1,54 +1,76 @@
 #include "Function.h"
+#include "Module.h"
+#include "FrozenModule.h"
 
 #include "Nodes/Special/Node_Root.h"
+#include "Nodes/Special/Node_Variable.h"
+#include "Nodes/Special/Node_UserDefined.h"
+#include "Compiler/EmitContext.h"
+#include "Compiler/GraphAnalysis.h"
 
 Function::Function(Alchemist* InstanceIn, string NameIn, int ArityIn)
-	: Instance(InstanceIn), Name(NameIn), Arity(ArityIn)
+	: Instance(InstanceIn), Pool(make_shared<NodePool>()), Name(NameIn), Arity(ArityIn)
 {}
 
 bool Function::PlaceNode(shared_ptr<Node> NewNode, const Point& Position)
 {
-	if (GetNodeAt(Position))
+	shared_ptr<Node> InTheWay = GetNodeAt(Position);
+
+	if (InTheWay)
 	{
-		// Space is occupied already
-		return false;
+		// Stop! Do nothing if the node is where we want it already. Otherwise the space is occupied.
+		return InTheWay == NewNode;
 	}
 
 	// Is this node on the grid already? (i.e. being moved)
-	int Found = -1;
+	NodeHandle Handle = GetNodeHandle(NewNode);
+	bool WasPlaced = Handle.IsValid();
 
-	for (int i = 0; i < NodesOnGrid.size(); i++)
+	if (WasPlaced)
+	{
+		Grid.Erase(NewNode->GridPosition);
+	}
+	else
 	{
-		if (NodesOnGrid[i] == NewNode)
+		// Add it, in a free slot if there is one.
+		if (FreeSlots.empty())
 		{
-			// We need to remove the lookup table entries.
-			Point PreviousPosition = GridReverseLookup[i];
+			NodeSlots.emplace_back();
+			Handle.Index = (uint32_t)NodeSlots.size() - 1;
+		}
+		else
+		{
+			Handle.Index = FreeSlots.back();
+			FreeSlots.pop_back();
+		}
 
-			if (PreviousPosition == Position)
-			{
-				// Stop! Do nothing if the node is where we want it already.
-				return true;
-			}
+		NodeSlot& Slot = NodeSlots[Handle.Index];
 
-			GridReverseLookup.erase(GridReverseLookup.find(i));
-			GridLookup.erase(GridLookup.find(PreviousPosition));
+		// Skip 0 when the generation wraps around, so the handle is never invalid.
+		Slot.Generation = Slot.Generation + 1 == 0 ? 1 : Slot.Generation + 1;
+		Slot.Instance = NewNode;
 
-			Found = i;
+		Handle.Generation = Slot.Generation;
+		NewNode->Handle = Handle;
 
-			break;
-		}
-	}
+		NodeCount++;
 
-	// Add if not found
-	if (Found == -1)
-	{
-		NodesOnGrid.push_back(NewNode);
-		Found = (int)NodesOnGrid.size() - 1;
+		// Whatever the node was copied from may have had consumers, but nothing uses this one yet.
+		// Its inputs only still mean something if it was in this function before (i.e. a copy made here).
+		NewNode->Consumers.clear();
+
+		if (NewNode->NodeFunction == this)
+		{
+			NewNode->LinkInputs();
+		}
+		else
+		{
+			NewNode->ClearConnectors();
+		}
 	}
 
-	// Add to lookups
-	GridLookup[Position] = Found;
-	GridReverseLookup[Found] = Position;
+	// Add to lookup
+	Grid.Set(Position, Handle);
 
 	// Tell node it's in a function now
 	if (NewNode->NodeFunction != this)
@@ -59,71 +81,253 @@ bool Function::PlaceNode(shared_ptr<Node> NewNode, const Point& Position)
 
 	NewNode->GridPosition = Position;
 
+	// Moving changes how long its connectors are.
+	RetrackConnectors(*NewNode);
+
+	// New calls go in the module's call site index.
+	if (!WasPlaced && ParentModule)
+	{
+		if (Node_UserDefined* Call = dynamic_cast<Node_UserDefined*>(NewNode.get()))
+		{
+			ParentModule->AddCallSite(Call);
+		}
+	}
+
+	MarkDirty();
+
 	return true;
 }
 
 shared_ptr<Node> Function::GetNodeAt(const Point& Position) const
 {
-	auto Found = GridLookup.find(Position);
+	const NodeSlot* Slot = FindSlot(Grid.Get(Position));
 
-	if (Found != GridLookup.end())
+	return Slot ? Slot->Instance : nullptr;
+}
+
+vector<shared_ptr<Node>> Function::GetNodesInArea(const Point& Min, const Point& Max) const
+{
+	vector<shared_ptr<Node>> Out;
+
+	Grid.ForEachInArea(Min, Max, [this, &Out](const Point& Cell, const NodeHandle& Handle)
 	{
-		return GetNode(Found->second);
-	}
+		if (const NodeSlot* Slot = FindSlot(Handle))
+		{
+			Out.push_back(Slot->Instance);
+		}
+	});
 
-	return nullptr;
+	return Out;
 }
 
-shared_ptr<Node> Function::GetNode(int ID) const
+void Function::ForEachNodeInArea(const Point& Min, const Point& Max, const function<void(const shared_ptr<Node>& NodeInstance)>& NodeFunction) const
 {
-	return NodesOnGrid[ID];
+	Grid.ForEachInArea(Min, Max, [this, &NodeFunction](const Point& Cell, const NodeHandle& Handle)
+	{
+		if (const NodeSlot* Slot = FindSlot(Handle))
+		{
+			NodeFunction(Slot->Instance);
+		}
+	});
 }
 
-void Function::RemoveNode(int ID)
+void Function::ForEachConnectorInArea(const Point& Min, const Point& Max, const function<void(const Node& Source, const Node& Consumer, int Argument)>& ConnectorFunction) const
 {
-	if (GridReverseLookup.find(ID) != GridReverseLookup.end())
+	// Kept together so the lambdas below only need two captures, and fit in std::function without allocating.
+	struct AreaQuery
 	{
-		NodesOnGrid.erase(NodesOnGrid.begin() + ID);
-		FixLookups();
-	}	
+		Point Min;
+		Point Max;
+		const function<void(const Node& Source, const Node& Consumer, int Argument)>& ConnectorFunction;
+
+		void Visit(const Node& Source, const Node& Consumer, int Argument) const
+		{
+			Point SourcePosition = Source.GetGridPosition();
+			Point ConsumerPosition = Consumer.GetGridPosition();
+
+			// Skip connectors whose bounding box misses the area.
+			if (max(SourcePosition.X, ConsumerPosition.X) < Min.X || min(SourcePosition.X, ConsumerPosition.X) > Max.X
+				|| max(SourcePosition.Y, ConsumerPosition.Y) < Min.Y || min(SourcePosition.Y, ConsumerPosition.Y) > Max.Y)
+			{
+				return;
+			}
+
+			ConnectorFunction(Source, Consumer, Argument);
+		}
+	};
+
+	AreaQuery Query{ Min, Max, ConnectorFunction };
+
+	// A short connector that crosses the area has its consumer within LongConnectorSpan cells of it.
+	Grid.ForEachInArea(Min - LongConnectorSpan, Max + LongConnectorSpan, [this, &Query](const Point& Cell, const NodeHandle& Handle)
+	{
+		const NodeSlot* Slot = FindSlot(Handle);
+
+		if (!Slot)
+		{
+			return;
+		}
+
+		const Node& Consumer = *Slot->Instance;
+
+		for (int i = 0; i < Consumer.GetNumArguments(); i++)
+		{
+			Node* Source = Consumer.GetConnector(i);
+
+			// Long ones are on the list below.
+			if (Source && !IsLongConnector(Source->GetGridPosition(), Consumer.GetGridPosition()))
+			{
+				Query.Visit(*Source, Consumer, i);
+			}
+		}
+	});
+
+	// Long connectors could be anywhere, so check each of them.
+	for (const auto& Entry : LongConnectors)
+	{
+		Node* Consumer = GetNode(Entry.second.Consumer);
+		Node* Source = Consumer ? Consumer->GetConnector(Entry.second.Argument) : nullptr;
+
+		if (Source)
+		{
+			Query.Visit(*Source, *Consumer, Entry.second.Argument);
+		}
+	}
+}
+
+Node* Function::GetNode(const NodeHandle& Handle) const
+{
+	const NodeSlot* Slot = FindSlot(Handle);
+
+	return Slot ? Slot->Instance.get() : nullptr;
+}
+
+void Function::RemoveNode(const NodeHandle& Handle)
+{
+	const NodeSlot* Slot = FindSlot(Handle);
+
+	if (!Slot)
+	{
+		return;
+	}
+
+	// Keep the node alive until we're done with it.
+	shared_ptr<Node> Removed = Slot->Instance;
+
+	Grid.Erase(Removed->GridPosition);
+
+	if (ParentModule)
+	{
+		if (Node_UserDefined* Call = dynamic_cast<Node_UserDefined*>(Removed.get()))
+		{
+			ParentModule->RemoveCallSite(Call);
+		}
+	}
+
+	// Disconnect it both ways while its handle still works. Nothing is left pointing at the node afterwards.
+	Removed->UnlinkInputs();
+	Removed->UnlinkConsumers();
+
+	// The generation changes when the slot is next used, so this handle won't find whatever goes in it.
+	NodeSlots[Handle.Index].Instance = nullptr;
+	FreeSlots.push_back(Handle.Index);
+	NodeCount--;
+
+	Removed->Handle = NodeHandle();
+
+	MarkDirty();
 }
 
 void Function::RemoveNode(const shared_ptr<Node>& NodeInstance)
 {
-	int NodeId = GetNodeId(NodeInstance);
+	RemoveNode(GetNodeHandle(NodeInstance));
+}
 
-	if (NodeId != -1)
+NodeHandle Function::GetNodeHandle(const shared_ptr<Node>& NodeInstance) const
+{
+	// Copies of a node carry its handle too, so make sure it's really this node in the slot.
+	if (NodeInstance && GetNode(NodeInstance->Handle) == NodeInstance.get())
 	{
-		RemoveNode(NodeId);
+		return NodeInstance->Handle;
 	}
+
+	return NodeHandle();
 }
 
-int Function::GetNodeId(const shared_ptr<Node>& NodeInstance) const
+const Function::NodeSlot* Function::FindSlot(const NodeHandle& Handle) const
 {
-	for (int i = 0; i < (int)NodesOnGrid.size(); i++)
+	if (!Handle.IsValid() || Handle.Index >= NodeSlots.size() || NodeSlots[Handle.Index].Generation != Handle.Generation)
 	{
-		if (NodesOnGrid[i] == NodeInstance)
+		return nullptr;
+	}
+
+	return &NodeSlots[Handle.Index];
+}
+
+bool Function::IsLongConnector(const Point& SourcePosition, const Point& ConsumerPosition)
+{
+	return abs(SourcePosition.X - ConsumerPosition.X) > LongConnectorSpan || abs(SourcePosition.Y - ConsumerPosition.Y) > LongConnectorSpan;
+}
+
+void Function::TrackConnector(const Node& Source, const Node& Consumer, int Argument)
+{
+	if (IsLongConnector(Source.GridPosition, Consumer.GridPosition))
+	{
+		LongConnectors[GetConnectorKey(Consumer.Handle, Argument)] = NodeConsumer{ Consumer.Handle, Argument };
+	}
+}
+
+void Function::UntrackConnector(const NodeHandle& Consumer, int Argument)
+{
+	if (!LongConnectors.empty())
+	{
+		LongConnectors.erase(GetConnectorKey(Consumer, Argument));
+	}
+}
+
+void Function::RetrackConnectors(const Node& MovedNode)
+{
+	for (int i = 0; i < MovedNode.GetNumArguments(); i++)
+	{
+		UntrackConnector(MovedNode.Handle, i);
+
+		if (Node* Source = MovedNode.GetConnector(i))
 		{
-			return i;
+			TrackConnector(*Source, MovedNode, i);
 		}
 	}
 
-	return -1;
+	for (const NodeConsumer& Entry : MovedNode.Consumers)
+	{
+		UntrackConnector(Entry.Consumer, Entry.Argument);
+
+		if (Node* Consumer = GetNode(Entry.Consumer))
+		{
+			TrackConnector(MovedNode, *Consumer, Entry.Argument);
+		}
+	}
 }
 
 void Function::SetArity(int NewArity)
 {
 	Arity = NewArity;
 
-	for(const shared_ptr<Node> Node : NodesOnGrid)
+	for(const NodeSlot& Slot : NodeSlots)
 	{
-		Node->OnFunctionChanged();
+		if (Slot.Instance)
+		{
+			Slot.Instance->OnFunctionChanged();
+		}
 	}
 
-	ParentModule->BroadcastOnModuleChanged();
+	MarkDirty();
+
+	// Only calls to us have arguments that depend on our arity.
+	ParentModule->MarkSignaturesDirty();
+	ParentModule->NotifyCallSites(this);
 }
 
-bool Function::Emit(string& Output, vector<CompilationProblem>& Problems) const
+bool Function::Emit(EmitSink& Output, vector<CompilationProblem>& Problems) const
 {
 	// First we need to find our list of root nodes.
 	// These nodes determine the different function patterns.
@@ -146,10 +350,27 @@ bool Function::Emit(string& Output, vector<CompilationProblem>& Problems) const
 	// The generated code will end with the final expression in the tree (the one connected to RetVal) as the return value.
 
 	bool Pass = true;
+
+	EmitContext Context(Problems);
+
+	// Variables we generate mustn't clash with the user's.
+	for (const shared_ptr<Node_Variable>& Variable : GetNodesOfClass<Node_Variable>())
+	{
+		Context.ReservedNames.insert(Variable->GetName());
+	}
+
+	// Find infinite loops before emitting anything, so emitting never has to keep track of where it has been.
+	for (Node* CycleNode : FindCycles(vector<shared_ptr<Node>>(RootNodes.begin(), RootNodes.end())))
+	{
+		Problems.push_back(CompilationProblem{ CycleNode->shared_from_this(), "Infinite loop detected!" });
+		Context.CycleNodes.insert(CycleNode);
+
+		Pass = false;
+	}
 	
 	for(int i = 0; i < RootNodes.size(); i++)
 	{
-		if(!RootNodes[i]->Emit(Output, Problems, {}))
+		if(!RootNodes[i]->Emit(Output, Context))
 		{
 			Pass = false;
 		}
@@ -163,25 +384,143 @@ bool Function::Emit(string& Output, vector<CompilationProblem>& Problems) const
 	return Pass;
 }
 
+bool Function::EmitCached(EmitSink& Output, vector<CompilationProblem>& Problems)
+{
+	UpdateCache();
+
+	CachedCode.AppendTo(Output);
+	Problems.insert(Problems.end(), CachedProblems.begin(), CachedProblems.end());
+
+	return CachedPass;
+}
+
+void Function::UpdateCache()
+{
+	if (!IsDirty())
+	{
+		return;
+	}
+
+	// The new code is usually about the same size as the old code.
+	EmitSink Code;
+	Code.Reserve(CachedCode.GetSize());
+
+	vector<CompilationProblem> NewProblems;
+
+	bool Pass = Emit(Code, NewProblems);
+	StoreEmitResult(Version, move(Code), move(NewProblems), Pass);
+}
+
+void Function::StoreEmitResult(int ForVersion, EmitSink&& Code, vector<CompilationProblem> Problems, bool Pass)
+{
+	if (ForVersion != Version)
+	{
+		return;
+	}
+
+	CachedCode = move(Code);
+	CachedProblems = move(Problems);
+	CachedPass = Pass;
+	CachedVersion = ForVersion;
+}
+
+void Function::CopyNodesInto(Function& Target, unordered_map<const Node*, weak_ptr<Node>>& SourceNodes) const
+{
+	assert(Target.NodeCount == 0 && Target.Arity == Arity);
+
+	unordered_map<const Node*, shared_ptr<Node>> Copies;
+	Copies.reserve(NodeCount);
+
+	// Copy nodes first...
+	for (const shared_ptr<Node>& Original : GetNodes())
+	{
+		shared_ptr<Node> Copy = Original->Clone(Target.Pool);
+		Copy->OnCopiedToModule(*Target.ParentModule);
+
+		Target.PlaceNode(Copy, Original->GetGridPosition());
+
+		Copies[Original.get()] = Copy;
+		SourceNodes[Copy.get()] = Original;
+	}
+
+	// ...then point their connectors at each other rather than at the originals.
+	for (const shared_ptr<Node>& Original : GetNodes())
+	{
+		const shared_ptr<Node>& Copy = Copies[Original.get()];
+
+		for (int i = 0; i < Copy->GetNumArguments(); i++)
+		{
+			Node* Connector = i < Original->GetNumArguments() ? Original->GetConnector(i) : nullptr;
+			auto FoundCopy = Connector ? Copies.find(Connector) : Copies.end();
+
+			if (FoundCopy != Copies.end())
+			{
+				Copy->SetConnector(FoundCopy->second.get(), i);
+			}
+			else
+			{
+				Copy->DisconnectConnector(i);
+			}
+		}
+	}
+}
+
+shared_ptr<const FrozenFunction> Function::Freeze(Module& Signatures)
+{
+	if (Frozen && Frozen->Version == Version)
+	{
+		return Frozen;
+	}
+
+	shared_ptr<FrozenFunction> NewFrozen = make_shared<FrozenFunction>();
+	NewFrozen->Version = Version;
+
+	shared_ptr<Function> Copy = make_shared<Function>(Instance, Name, Arity);
+	Copy->ParentModule = &Signatures;
+
+	CopyNodesInto(*Copy, NewFrozen->SourceNodes);
+
+	// The signatures module keeps changing as the module is frozen again, so the copy shouldn't keep pointing at it.
+	Copy->ParentModule = nullptr;
+
+	for (const shared_ptr<Node_UserDefined>& Call : Copy->GetNodesOfClass<Node_UserDefined>())
+	{
+		if (shared_ptr<Function> Callee = Call->GetCalledFunction())
+		{
+			NewFrozen->Callees.push_back(Callee);
+		}
+	}
+
+	NewFrozen->Copy = Copy;
+	Frozen = NewFrozen;
+
+	return Frozen;
+}
+
 void Function::Rename(const string& NewName)
 {
-	if(GetInstance()->GetCurrentModule()->GetFunction(NewName))
+	if(ParentModule->GetFunction(NewName))
 	{
 		return;
 	}
 	
+	string OldName = Name;
+
 	Name = NewName;
-	Instance->GetCurrentModule()->UpdateLookups();
+	ParentModule->UpdateLookup(OldName, NewName);
+	ParentModule->MarkSignaturesDirty();
+
+	// Our own clause heads and every call to us contain the name.
+	MarkDirty();
+	ParentModule->MarkCallersDirty(this);
 }
 
-void Function::FixLookups()
+void Function::MarkDirty()
 {
-	GridLookup.clear();
-	GridReverseLookup.clear();
-	
-	for(int i = 0; i < (int)NodesOnGrid.size(); i++)
+	Version++;
+
+	if (ParentModule)
 	{
-		GridLookup[NodesOnGrid[i]->GetGridPosition()] = i;
-		GridReverseLookup[i] = NodesOnGrid[i]->GetGridPosition();
+		ParentModule->MarkDirty();
 	}
 }
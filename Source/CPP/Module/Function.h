@@ -3,31 +3,96 @@
 #pragma once
 
 #include "Libs.h"
-#include "Alchemist.h"
+#include "Nodes/Nodes.h"
 #include "CompilationProblem.h"
+#include "Compiler/EmitSink.h"
+#include "NodeGrid.h"
+
+class Alchemist;
+class Module;
+struct FrozenFunction;
 
 /**
  * A function within the user's program.
  */
 class Function
 {
+private:
+	/** One place a node can be kept. Empty slots are reused by the next node added. */
+	struct NodeSlot
+	{
+		shared_ptr<Node> Instance;
+		uint32_t Generation = 0;
+	};
+
+public:
+	/** A read-only view of the nodes in a function. Iterating it skips empty slots. */
+	class NodeRange
+	{
+	public:
+		class Iterator
+		{
+		public:
+			Iterator(vector<NodeSlot>::const_iterator SlotIn, vector<NodeSlot>::const_iterator EndIn)
+				: Slot(SlotIn), End(EndIn)
+			{
+				SkipEmpty();
+			}
+
+			const shared_ptr<Node>& operator*() const { return Slot->Instance; }
+			bool operator!=(const Iterator& Other) const { return Slot != Other.Slot; }
+
+			Iterator& operator++()
+			{
+				++Slot;
+				SkipEmpty();
+
+				return *this;
+			}
+
+		private:
+			void SkipEmpty()
+			{
+				while (Slot != End && !Slot->Instance)
+				{
+					++Slot;
+				}
+			}
+
+			vector<NodeSlot>::const_iterator Slot;
+			vector<NodeSlot>::const_iterator End;
+		};
+
+		NodeRange(const vector<NodeSlot>& SlotsIn) : Slots(SlotsIn) {}
+
+		Iterator begin() const { return Iterator(Slots.begin(), Slots.end()); }
+		Iterator end() const { return Iterator(Slots.end(), Slots.end()); }
+
+	private:
+		const vector<NodeSlot>& Slots;
+	};
+
 public:
 	Function(Alchemist* InstanceIn, string NameIn, int ArityIn);
 
-	/** Creates a node at the given grid position. */
-	shared_ptr<Node> CreateNode(int NodeID, const Point& Position)
+	/** Creates a node from the node manager at the given grid position. Returns null if there's no such node, or something was in the way. */
+	shared_ptr<Node> CreateNode(const NodeManager& Nodes, int NodeID, const Point& Position)
 	{
-		shared_ptr<Node> NewNode = Instance->GetNodeManager()->CreateNode(NodeID);
-		PlaceNode(NewNode, Position);
+		shared_ptr<Node> NewNode = Nodes.CreateNode(NodeID, Pool);
+
+		if (!NewNode || !PlaceNode(NewNode, Position))
+		{
+			return nullptr;
+		}
 
 		return NewNode;
 	}
 
 	/** Finds the node matching the given class and creates it at the given grid position. */
 	template<class NodeClass>
-	shared_ptr<NodeClass> CreateNode(const Point& Position)
+	shared_ptr<NodeClass> CreateNode(const NodeManager& Nodes, const Point& Position)
 	{
-		shared_ptr<NodeClass> NewNode = Instance->GetNodeManager()->CreateNode<NodeClass>();
+		shared_ptr<NodeClass> NewNode = Nodes.CreateNode<NodeClass>(Pool);
 		PlaceNode(NewNode, Position);
 
 		return NewNode;
@@ -42,20 +107,47 @@ public:
 	/** Returns the node at the specified grid position, if there is any. */
 	shared_ptr<Node> GetNodeAt(const Point& Position) const;
 
-	/** Returns node with ID given. */
-	shared_ptr<Node> GetNode(int ID) const;
+	/**
+	 * Returns every node between the two grid positions (inclusive), in no particular order (i.e. the nodes on screen, or in a box selection).
+	 * Only looks at the occupied cells in the area, so this is cheap for small areas of big functions.
+	 */
+	vector<shared_ptr<Node>> GetNodesInArea(const Point& Min, const Point& Max) const;
+
+	/** Calls a function with every node between the two grid positions (inclusive), in no particular order. Like GetNodesInArea, but nothing is copied. */
+	void ForEachNodeInArea(const Point& Min, const Point& Max, const function<void(const shared_ptr<Node>& NodeInstance)>& NodeFunction) const;
+
+	/**
+	 * Calls a function with every connector that may pass through the area between the two grid positions (inclusive), in no particular order (i.e. the connectors on screen).
+	 * Short connectors are found from the nodes around the area, and long ones from a list kept up to date as they change, so the cost doesn't go with the size of the function.
+	 */
+	void ForEachConnectorInArea(const Point& Min, const Point& Max, const function<void(const Node& Source, const Node& Consumer, int Argument)>& ConnectorFunction) const;
+
+	/**
+	 * Returns the node with the given handle, or null if it has been removed since.
+	 * No reference is taken, so this is cheap - use shared_from_this() to keep hold of the node.
+	 */
+	Node* GetNode(const NodeHandle& Handle) const;
 	
-	/** Deletes node with ID given. */
-	void RemoveNode(int ID);
+	/** Deletes the node with the given handle. */
+	void RemoveNode(const NodeHandle& Handle);
 
 	/** Deletes node. */
 	void RemoveNode(const shared_ptr<Node>& NodeInstance);
 
-	/** Returns ID of node. */
-	int GetNodeId(const shared_ptr<Node>& NodeInstance) const;
+	/** Returns the handle of a node in this function. Invalid if the node isn't in it. */
+	NodeHandle GetNodeHandle(const shared_ptr<Node>& NodeInstance) const;
 
-	/** Returns a copy of the list of all nodes. */
-	vector<shared_ptr<Node>> GetNodes() const { return NodesOnGrid; }
+	/** Returns the pool the function's nodes are allocated from. Create nodes in it (see MakeNode) before placing them here. */
+	const shared_ptr<NodePool>& GetNodePool() const { return Pool; }
+
+	/** Returns how many nodes are in the function. */
+	int GetNodeCount() const { return NodeCount; }
+
+	/**
+	 * Returns every node, in slot order, for going through with a range-based for loop.
+	 * This is a view of the function's own slots, so nothing is copied - but don't add or remove nodes while going through it.
+	 */
+	NodeRange GetNodes() const { return NodeRange(NodeSlots); }
 
 	/** Returns all nodes of the given type. */
 	template<class NodeClass>
@@ -63,9 +155,9 @@ public:
 	{
 		vector<shared_ptr<NodeClass>> Out;
 
-		for(int i = 0; i < NodesOnGrid.size(); i++)
+		for(const NodeSlot& Slot : NodeSlots)
 		{
-			shared_ptr<NodeClass> NodeAsClass = dynamic_pointer_cast<NodeClass>(NodesOnGrid[i]);
+			shared_ptr<NodeClass> NodeAsClass = dynamic_pointer_cast<NodeClass>(Slot.Instance);
 
 			if(NodeAsClass)
 			{
@@ -83,31 +175,113 @@ public:
 	void SetArity(int NewArity);
 
 	/** Returns function's name. */
-	string GetName() const { return Name; }
+	const string& GetName() const { return Name; }
 
 	/** Returns alchemist application instance. */
 	Alchemist* GetInstance() const { return Instance; }
 
+	/** Returns the module the function belongs to. */
+	Module* GetModule() const { return ParentModule; }
+
 	/** Emits Erlang code for the function. */
-	bool Emit(string& Output, vector<CompilationProblem>& Problems) const;
+	bool Emit(EmitSink& Output, vector<CompilationProblem>& Problems) const;
+
+	/**
+	 * Appends the function's Erlang code to the output, re-emitting only if the function changed since the last call.
+	 * Returns the same result as Emit.
+	 */
+	bool EmitCached(EmitSink& Output, vector<CompilationProblem>& Problems);
+
+	/** Re-emits the function into its cache if it changed since the last emit. */
+	void UpdateCache();
+
+	/** Caches the result of emitting the function elsewhere (i.e. from a frozen copy). Ignored if the function changed since that version. */
+	void StoreEmitResult(int ForVersion, EmitSink&& Code, vector<CompilationProblem> Problems, bool Pass);
+
+	/** Returns the code from the last emit. */
+	const EmitSink& GetCachedCode() const { return CachedCode; }
+
+	/** Returns the problems from the last emit. */
+	const vector<CompilationProblem>& GetCachedProblems() const { return CachedProblems; }
+
+	/** Returns whether the last emit passed. */
+	bool GetCachedPass() const { return CachedPass; }
+
+	/** Returns the version the cached results are for, or -1 if the function has never been emitted. */
+	int GetCachedVersion() const { return CachedVersion; }
+
+	/** Copies every node and connector into another, empty function with the same signature. Records copy -> original pairs in SourceNodes. */
+	void CopyNodesInto(Function& Target, unordered_map<const Node*, weak_ptr<Node>>& SourceNodes) const;
+
+	/**
+	 * Returns an immutable copy of the function as it is now. Calls in the copy point at the given module's functions (see Module::Freeze).
+	 * The same copy is returned until the function changes. After that the whole function is copied again, so this costs O(nodes) for any edit.
+	 */
+	shared_ptr<const FrozenFunction> Freeze(Module& Signatures);
 
 	/** Renames the function. */
 	void Rename(const string& NewName);
+
+	/** Marks the function as changed, so that it is re-emitted on the next compile. */
+	void MarkDirty();
+
+	/** Returns true if the function has changed since it was last emitted. */
+	bool IsDirty() const { return CachedVersion != Version; }
+
+	/** Returns the function's version stamp. This goes up every time the function is changed. */
+	int GetVersion() const { return Version; }
+
+public:
+	/** Connectors spanning more than this many cells (across or down) are kept in a list, as they can cross an area without either end being near it. */
+	static constexpr int LongConnectorSpan = 8;
 	
 private:
-	/** Recreates all values in the lookup table. */
-	void FixLookups();
-	
+	/** Returns the slot the handle refers to, or null if the handle is out of date. */
+	const NodeSlot* FindSlot(const NodeHandle& Handle) const;
+
+	/** Adds a connector to the long connector list, if it is long. Both nodes must be placed. */
+	void TrackConnector(const Node& Source, const Node& Consumer, int Argument);
+
+	/** Takes a connector off the long connector list, if it is on it. */
+	void UntrackConnector(const NodeHandle& Consumer, int Argument);
+
+	/** Checks the length of every connector to and from a node again, after it has moved. */
+	void RetrackConnectors(const Node& MovedNode);
+
+	/** Returns true if a connector between the two positions goes on the long connector list. */
+	static bool IsLongConnector(const Point& SourcePosition, const Point& ConsumerPosition);
+
+	/** Returns the key a connector is found by in the long connector list. */
+	static uint64_t GetConnectorKey(const NodeHandle& Consumer, int Argument) { return ((uint64_t)Consumer.Index << 32) | (uint32_t)Argument; }
+
 private:
 	Alchemist* Instance;
 
-	vector<shared_ptr<Node>> NodesOnGrid;
-	unordered_map<Point, int> GridLookup; // for looking up nodes from grid positions
-	unordered_map<int, Point> GridReverseLookup; // for looking up grid positions from nodes
+	shared_ptr<NodePool> Pool;
+	vector<NodeSlot> NodeSlots;
+	vector<uint32_t> FreeSlots;
+	int NodeCount = 0;
+	NodeGrid Grid; // for looking up nodes from grid positions
+	unordered_map<uint64_t, NodeConsumer> LongConnectors; // connectors longer than LongConnectorSpan, by GetConnectorKey
 	
 	string Name;
 	int Arity = 0;
-	Module* ParentModule;
+	Module* ParentModule = nullptr;
+
+	int Version = 0;
+
+	// Results of the last emit, reused until the version changes
+	int CachedVersion = -1;
+	bool CachedPass = false;
+	EmitSink CachedCode;
+	vector<CompilationProblem> CachedProblems;
+
+	// The last frozen copy, handed out again until the version changes
+	shared_ptr<const FrozenFunction> Frozen;
+
+	// Stands in for this function in frozen calls to it. Replaced when the name or arity changes.
+	shared_ptr<Function> Signature;
 
 	friend class Module;
+	friend class Node;
 };
\ No newline at end of file
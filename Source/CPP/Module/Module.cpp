@@ -1,9 +1,9 @@
 // Copyright Chris Sixsmith 2020.
 
 #include "Module.h"
-#include "Alchemist.h"
 #include "Function.h"
 #include "Nodes/Nodes.h"
+#include "Nodes/Special/Node_UserDefined.h"
 
 Module::Module(Alchemist* InstanceIn, string NameIn)
 	: Instance(InstanceIn), Name(NameIn)
@@ -16,13 +16,9 @@ shared_ptr<Function> Module::CreateOrGetFunction(string Name, int Arity)
 		return Existing;
 	}
 
-	shared_ptr<Function> NewFunction = make_shared<Function>(Instance, Name, Arity);
-	NewFunction->ParentModule = this;
-
-	Functions.push_back(NewFunction);
-	FunctionLookupTable[Name] = (int)Functions.size() - 1;
+	shared_ptr<Function> NewFunction = AddFunction(Name, Arity);
 
-	BroadcastOnModuleChanged();
+	MarkDirty();
 	
 	return NewFunction;
 }
@@ -64,18 +60,58 @@ shared_ptr<Function> Module::GetFunction(string Name)
 
 void Module::RemoveFunction(string Name)
 {
-	FunctionLookupTable.erase(Name);
+	auto Found = FunctionLookupTable.find(Name);
+
+	if (Found == FunctionLookupTable.end())
+	{
+		return;
+	}
+
+	int Index = Found->second;
+	shared_ptr<Function> Removed = Functions[Index];
+
+	// The calls it makes aren't in the module anymore.
+	for (const shared_ptr<Node_UserDefined>& Call : Removed->GetNodesOfClass<Node_UserDefined>())
+	{
+		RemoveCallSite(Call.get());
+	}
+
+	FunctionLookupTable.erase(Found);
+	Functions.erase(Functions.begin() + Index);
 
-	for (int i = 0; i < Functions.size(); i++)
+	// Later functions shifted down.
+	for (int i = Index; i < Functions.size(); i++)
 	{
-		if(Functions[i]->Name == Name)
+		FunctionLookupTable[Functions[i]->Name] = i;
+	}
+
+	MarkSignaturesDirty();
+
+	// Calls to it can't be emitted anymore, so they're removed too.
+	auto FoundCalls = CallSites.find(Removed.get());
+
+	if (FoundCalls != CallSites.end())
+	{
+		vector<Node_UserDefined*> Calls = move(FoundCalls->second);
+		CallSites.erase(FoundCalls);
+
+		for (Node_UserDefined* Call : Calls)
 		{
-			Functions.erase(Functions.begin() + i);
-			break;
+			Call->GetFunction()->RemoveNode(Call->shared_from_this());
 		}
 	}
 
-	BroadcastOnModuleChanged();
+	MarkDirty();
+}
+
+void Module::Clear()
+{
+	Functions.clear();
+	FunctionLookupTable.clear();
+	CallSites.clear();
+
+	MarkDirty();
+	MarkSignaturesDirty();
 }
 
 void Module::UpdateLookups()
@@ -88,13 +124,151 @@ void Module::UpdateLookups()
 	}
 }
 
-void Module::BroadcastOnModuleChanged()
+void Module::UpdateLookup(const string& OldName, const string& NewName)
 {
-	for (int i = 0; i < Functions.size(); i++)
+	auto Found = FunctionLookupTable.find(OldName);
+
+	if (Found == FunctionLookupTable.end())
 	{
-		for(const shared_ptr<Node>& Node : Functions[i]->GetNodes())
+		return;
+	}
+
+	int Index = Found->second;
+
+	FunctionLookupTable.erase(Found);
+	FunctionLookupTable[NewName] = Index;
+}
+
+const vector<Node_UserDefined*>& Module::GetCallSites(const Function* Callee) const
+{
+	static const vector<Node_UserDefined*> NoCallSites;
+
+	auto Found = CallSites.find(Callee);
+
+	return Found != CallSites.end() ? Found->second : NoCallSites;
+}
+
+void Module::NotifyCallSites(const Function* Callee)
+{
+	// Calls can remove themselves, so go through a copy.
+	vector<Node_UserDefined*> Calls = GetCallSites(Callee);
+
+	for (Node_UserDefined* Call : Calls)
+	{
+		Call->OnModuleChanged();
+	}
+}
+
+shared_ptr<const FrozenModule> Module::Freeze()
+{
+	// Signatures first, so frozen call nodes have something to point at. They only change when a function is added, removed, renamed or changes arity.
+	// A function keeps the same signature object until it is renamed or its arity changes. Callers are frozen again when that happens, so they point at the new one.
+	if (!Signatures)
+	{
+		Signatures = make_unique<Module>(Instance, Name);
+	}
+
+	if (FrozenSignatureVersion != SignatureVersion)
+	{
+		Signatures->Functions.clear();
+
+		for (const shared_ptr<Function>& Func : Functions)
 		{
-			Node->OnModuleChanged();
+			if (!Func->Signature || Func->Signature->Name != Func->Name || Func->Signature->Arity != Func->Arity)
+			{
+				if (Func->Signature)
+				{
+					MarkCallersDirty(Func.get());
+				}
+
+				Func->Signature = make_shared<Function>(Instance, Func->Name, Func->Arity);
+			}
+
+			Func->Signature->ParentModule = Signatures.get();
+			Signatures->Functions.push_back(Func->Signature);
 		}
+
+		Signatures->UpdateLookups();
+
+		FrozenSignatureVersion = SignatureVersion;
+	}
+
+	shared_ptr<FrozenModule> NewFrozen = make_shared<FrozenModule>();
+
+	NewFrozen->ModuleVersion = Version;
+	NewFrozen->Name = Name;
+	NewFrozen->Functions.reserve(Functions.size());
+
+	// Then every function's contents. Only functions that changed since the last freeze are copied.
+	for (const shared_ptr<Function>& Func : Functions)
+	{
+		NewFrozen->Functions.push_back(FrozenModuleEntry{ Func, Func->GetVersion(), Func->Freeze(*Signatures), Func->IsDirty(), Func->GetCachedCode().GetSize() });
+	}
+
+	return NewFrozen;
+}
+
+shared_ptr<Function> Module::AddFunction(const string& FunctionName, int Arity)
+{
+	shared_ptr<Function> NewFunction = make_shared<Function>(Instance, FunctionName, Arity);
+	NewFunction->ParentModule = this;
+
+	Functions.push_back(NewFunction);
+	FunctionLookupTable[FunctionName] = (int)Functions.size() - 1;
+
+	MarkSignaturesDirty();
+
+	return NewFunction;
+}
+
+void Module::MarkCallersDirty(const Function* Callee)
+{
+	for (Node_UserDefined* Call : GetCallSites(Callee))
+	{
+		Call->GetFunction()->MarkDirty();
 	}
 }
+
+void Module::AddCallSite(Node_UserDefined* Call)
+{
+	shared_ptr<Function> Callee = Call->GetCalledFunction();
+
+	if (!Callee || !Contains(Callee.get()) || !Contains(Call->GetFunction()))
+	{
+		return;
+	}
+
+	CallSites[Callee.get()].push_back(Call);
+}
+
+void Module::RemoveCallSite(Node_UserDefined* Call)
+{
+	auto Found = CallSites.find(Call->GetCalledFunction().get());
+
+	if (Found == CallSites.end())
+	{
+		return;
+	}
+
+	vector<Node_UserDefined*>& Calls = Found->second;
+	auto FoundCall = find(Calls.begin(), Calls.end(), Call);
+
+	if (FoundCall == Calls.end())
+	{
+		return;
+	}
+
+	// Order doesn't matter, so swap the last one into the gap.
+	*FoundCall = Calls.back();
+	Calls.pop_back();
+
+	if (Calls.empty())
+	{
+		CallSites.erase(Found);
+	}
+}
+
+bool Module::Contains(const Function* Func) const
+{
+	return Func && GetFunction(Func->GetName()).get() == Func;
+}
@@ -3,9 +3,11 @@
 #pragma once
 
 #include "Libs.h"
+#include "FrozenModule.h"
 
 class Alchemist;
 class Function;
+class Node_UserDefined;
 
 class Module
 {
@@ -27,11 +29,14 @@ public:
 	/** Removes a function. */
 	void RemoveFunction(string Name);
 
-	/** Returns the module's full function list. */
-	vector<shared_ptr<Function>> GetFunctions() const { return Functions; }
+	/** Removes every function. */
+	void Clear();
+
+	/** Returns the module's full function list. This is the module's own list, so it changes as functions are added and removed. */
+	const vector<shared_ptr<Function>>& GetFunctions() const { return Functions; }
 
 	/** Returns module's name. */
-	string GetName() const { return Name; }
+	const string& GetName() const { return Name; }
 
 	/** Returns alchemist application instance. */
 	Alchemist* GetInstance() const { return Instance; }
@@ -39,13 +44,68 @@ public:
 	/** Rebuilds function lookup. */
 	void UpdateLookups();
 
-	/** Handles module change. */
-	void BroadcastOnModuleChanged();
+	/** Moves a function to its new name in the lookup. Called by functions when they're renamed. */
+	void UpdateLookup(const string& OldName, const string& NewName);
+
+	/**
+	 * Returns every node in the module calling the given function, in no particular order.
+	 * Kept up to date as call nodes are placed and removed, so changing a function's signature only has to visit its callers.
+	 */
+	const vector<Node_UserDefined*>& GetCallSites(const Function* Callee) const;
+
+	/** Lets every node calling the given function know its signature changed. */
+	void NotifyCallSites(const Function* Callee);
+
+	/** Marks every function containing a call to the given function as changed. */
+	void MarkCallersDirty(const Function* Callee);
+
+	/** Adds a call node to the call site index. Called by functions when one is placed in them. Ignored unless both ends of the call are in the module. */
+	void AddCallSite(Node_UserDefined* Call);
+
+	/** Removes a call node from the call site index. Called by functions when one is removed from them. */
+	void RemoveCallSite(Node_UserDefined* Call);
+
+	/** Marks the module as changed. Called by functions when they change. */
+	void MarkDirty() { Version++; }
+
+	/** Returns the module's version stamp. This goes up every time the module or any function in it is changed. */
+	int GetVersion() const { return Version; }
+
+	/** Marks the module's function signatures as changed. Called by functions when they're renamed or their arity changes. */
+	void MarkSignaturesDirty() { SignatureVersion++; }
+
+	/** Returns a stamp that goes up every time a function is added, removed, renamed or changes arity (i.e. when the list of nodes calling them needs rebuilding). */
+	int GetSignatureVersion() const { return SignatureVersion; }
+
+	/**
+	 * Makes an immutable copy of the module, which can be read from any thread while the live module is edited.
+	 * This is incremental per function, not a constant time snapshot:
+	 * - Functions that haven't changed since the last freeze are shared with it rather than copied again.
+	 * - Functions that have are copied whole, node by node, on the calling thread - O(nodes in the function) each, however small the edit was.
+	 * - Every function still gets an entry, so there is also an O(functions) walk. The signatures calls are pointed at are only rebuilt when one changes.
+	 */
+	shared_ptr<const FrozenModule> Freeze();
+
+private:
+	/** Adds a new function to the list without telling anyone. */
+	shared_ptr<Function> AddFunction(const string& FunctionName, int Arity);
+
+	/** Returns true if the function is one of ours (as opposed to a copy with the same name). */
+	bool Contains(const Function* Func) const;
 
 private:
 	Alchemist* Instance;
 	vector<shared_ptr<Function>> Functions;
 	unordered_map<string, int> FunctionLookupTable;
 
+	// Every call node in the module, by the function it calls. Nodes are taken out before they're removed, so the pointers never dangle.
+	unordered_map<const Function*, vector<Node_UserDefined*>> CallSites;
+
 	string Name;
+	int Version = 0;
+	int SignatureVersion = 0;
+
+	// Holds the signature of every function as of the last freeze, so frozen calls can be pointed at them. Only used while freezing.
+	unique_ptr<Module> Signatures;
+	int FrozenSignatureVersion = -1; // SignatureVersion when Signatures was last rebuilt
 };
\ No newline at end of file
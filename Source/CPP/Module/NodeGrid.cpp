@@ -0,0 +1,273 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "NodeGrid.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/** Returns the index of the lowest set bit. Mask must not be 0. */
+static int FindLowestBit(uint32_t Mask)
+{
+#if defined(_MSC_VER)
+	unsigned long Index;
+	_BitScanForward(&Index, Mask);
+	return (int)Index;
+#else
+	return __builtin_ctz(Mask);
+#endif
+}
+
+/** Returns a mask with bits First to Last (inclusive) set. */
+static uint32_t GetColumnMask(int First, int Last)
+{
+	uint32_t UpToLast = Last >= 31 ? 0xFFFFFFFFu : (1u << (Last + 1)) - 1;
+	uint32_t BelowFirst = (1u << First) - 1;
+
+	return UpToLast & ~BelowFirst;
+}
+
+NodeHandle NodeGrid::Get(const Point& Cell) const
+{
+	const Chunk* FoundChunk = FindChunk(GetChunkKey(Cell));
+
+	if (!FoundChunk)
+	{
+		return NodeHandle();
+	}
+
+	Point Local = Cell - FoundChunk->Key * ChunkSize;
+
+	return FoundChunk->Cells[Local.Y * ChunkSize + Local.X];
+}
+
+void NodeGrid::Set(const Point& Cell, const NodeHandle& Handle)
+{
+	if (!Handle.IsValid())
+	{
+		Erase(Cell);
+		return;
+	}
+
+	Chunk& SetChunk = FindOrAddChunk(GetChunkKey(Cell));
+	Point Local = Cell - SetChunk.Key * ChunkSize;
+
+	uint32_t Bit = 1u << Local.X;
+
+	if (!(SetChunk.RowMasks[Local.Y] & Bit))
+	{
+		SetChunk.RowMasks[Local.Y] |= Bit;
+		SetChunk.Count++;
+		CellCount++;
+	}
+
+	SetChunk.Cells[Local.Y * ChunkSize + Local.X] = Handle;
+}
+
+void NodeGrid::Erase(const Point& Cell)
+{
+	Point Key = GetChunkKey(Cell);
+	Chunk* EraseChunk = FindChunk(Key);
+
+	if (!EraseChunk)
+	{
+		return;
+	}
+
+	Point Local = Cell - Key * ChunkSize;
+	uint32_t Bit = 1u << Local.X;
+
+	if (!(EraseChunk->RowMasks[Local.Y] & Bit))
+	{
+		return;
+	}
+
+	EraseChunk->RowMasks[Local.Y] &= ~Bit;
+	EraseChunk->Cells[Local.Y * ChunkSize + Local.X] = NodeHandle();
+	EraseChunk->Count--;
+	CellCount--;
+
+	if (EraseChunk->Count == 0)
+	{
+		RemoveChunk(Key);
+	}
+}
+
+void NodeGrid::Clear()
+{
+	ChunkMap.clear();
+	Chunks.clear();
+	CellCount = 0;
+}
+
+void NodeGrid::ForEachInArea(const Point& Min, const Point& Max, const function<void(const Point& Cell, const NodeHandle& Handle)>& CellFunction) const
+{
+	if (Min.X > Max.X || Min.Y > Max.Y || Chunks.empty())
+	{
+		return;
+	}
+
+	Point MinKey = GetChunkKey(Min);
+	Point MaxKey = GetChunkKey(Max);
+
+	int64_t AreaChunks = ((int64_t)MaxKey.X - MinKey.X + 1) * ((int64_t)MaxKey.Y - MinKey.Y + 1);
+
+	if (AreaChunks > (int64_t)Chunks.size())
+	{
+		// The area covers more chunk positions than there are chunks, so it's quicker to go through the chunks.
+		for (const unique_ptr<Chunk>& AreaChunk : Chunks)
+		{
+			if (AreaChunk->Key.X >= MinKey.X && AreaChunk->Key.X <= MaxKey.X && AreaChunk->Key.Y >= MinKey.Y && AreaChunk->Key.Y <= MaxKey.Y)
+			{
+				ForEachInChunk(*AreaChunk, Min, Max, CellFunction);
+			}
+		}
+
+		return;
+	}
+
+	for (int KeyY = MinKey.Y; KeyY <= MaxKey.Y; KeyY++)
+	{
+		for (int KeyX = MinKey.X; KeyX <= MaxKey.X; KeyX++)
+		{
+			if (const Chunk* AreaChunk = FindChunk(Point(KeyX, KeyY)))
+			{
+				ForEachInChunk(*AreaChunk, Min, Max, CellFunction);
+			}
+		}
+	}
+}
+
+Point NodeGrid::GetChunkKey(const Point& Cell)
+{
+	// Plain division rounds towards zero, which would put cells -1 and 0 in the same chunk.
+	auto FloorDivide = [](int Value)
+	{
+		return Value >= 0 ? Value / ChunkSize : -((-(Value + 1)) / ChunkSize) - 1;
+	};
+
+	return Point(FloorDivide(Cell.X), FloorDivide(Cell.Y));
+}
+
+const NodeGrid::Chunk* NodeGrid::FindChunk(const Point& Key) const
+{
+	if (ChunkMap.empty())
+	{
+		return nullptr;
+	}
+
+	const ChunkMapEntry& Entry = ChunkMap[FindEntry(Key)];
+
+	return Entry.ChunkIndex >= 0 ? Chunks[Entry.ChunkIndex].get() : nullptr;
+}
+
+size_t NodeGrid::FindEntry(const Point& Key) const
+{
+	// Linear probing. The map is never full, so this always stops.
+	size_t Mask = ChunkMap.size() - 1;
+	size_t Index = hash<Point>{}(Key) & Mask;
+
+	while (ChunkMap[Index].ChunkIndex >= 0 && ChunkMap[Index].Key != Key)
+	{
+		Index = (Index + 1) & Mask;
+	}
+
+	return Index;
+}
+
+NodeGrid::Chunk& NodeGrid::FindOrAddChunk(const Point& Key)
+{
+	if ((Chunks.size() + 1) * 2 > ChunkMap.size())
+	{
+		GrowMap();
+	}
+
+	ChunkMapEntry& Entry = ChunkMap[FindEntry(Key)];
+
+	if (Entry.ChunkIndex < 0)
+	{
+		Entry.Key = Key;
+		Entry.ChunkIndex = (int)Chunks.size();
+
+		Chunks.push_back(make_unique<Chunk>());
+		Chunks.back()->Key = Key;
+	}
+
+	return *Chunks[Entry.ChunkIndex];
+}
+
+void NodeGrid::RemoveChunk(const Point& Key)
+{
+	size_t Mask = ChunkMap.size() - 1;
+	size_t Hole = FindEntry(Key);
+	int RemovedIndex = ChunkMap[Hole].ChunkIndex;
+
+	assert(RemovedIndex >= 0 && Chunks[RemovedIndex]->Count == 0);
+
+	// Move the last chunk into the gap, and point its map entry at its new place.
+	if (RemovedIndex + 1 < (int)Chunks.size())
+	{
+		ChunkMap[FindEntry(Chunks.back()->Key)].ChunkIndex = RemovedIndex;
+		Chunks[RemovedIndex] = move(Chunks.back());
+	}
+
+	Chunks.pop_back();
+
+	// Remove the map entry by shifting later entries in the same probe sequence back, rather than leaving a tombstone.
+	ChunkMap[Hole].ChunkIndex = -1;
+
+	for (size_t Index = (Hole + 1) & Mask; ChunkMap[Index].ChunkIndex >= 0; Index = (Index + 1) & Mask)
+	{
+		size_t Home = hash<Point>{}(ChunkMap[Index].Key) & Mask;
+
+		// The entry can fill the hole if the hole is between its home and where it is now (going round the end of the map).
+		bool CanMove = Hole <= Index ? (Home <= Hole || Home > Index) : (Home <= Hole && Home > Index);
+
+		if (CanMove)
+		{
+			ChunkMap[Hole] = ChunkMap[Index];
+			ChunkMap[Index].ChunkIndex = -1;
+			Hole = Index;
+		}
+	}
+}
+
+void NodeGrid::GrowMap()
+{
+	vector<ChunkMapEntry> OldMap = move(ChunkMap);
+	ChunkMap = vector<ChunkMapEntry>(max<size_t>(16, OldMap.size() * 2));
+
+	for (const ChunkMapEntry& Entry : OldMap)
+	{
+		if (Entry.ChunkIndex >= 0)
+		{
+			ChunkMap[FindEntry(Entry.Key)] = Entry;
+		}
+	}
+}
+
+void NodeGrid::ForEachInChunk(const Chunk& SearchChunk, const Point& Min, const Point& Max, const function<void(const Point& Cell, const NodeHandle& Handle)>& CellFunction)
+{
+	Point Origin = SearchChunk.Key * ChunkSize;
+
+	// The part of the area inside this chunk, in chunk-local cells.
+	int FirstColumn = max(Min.X - Origin.X, 0);
+	int LastColumn = min(Max.X - Origin.X, ChunkSize - 1);
+	int FirstRow = max(Min.Y - Origin.Y, 0);
+	int LastRow = min(Max.Y - Origin.Y, ChunkSize - 1);
+
+	uint32_t ColumnMask = GetColumnMask(FirstColumn, LastColumn);
+
+	for (int Row = FirstRow; Row <= LastRow; Row++)
+	{
+		uint32_t RowMask = SearchChunk.RowMasks[Row] & ColumnMask;
+
+		while (RowMask)
+		{
+			int Column = FindLowestBit(RowMask);
+			RowMask &= RowMask - 1;
+
+			CellFunction(Point(Origin.X + Column, Origin.Y + Row), SearchChunk.Cells[Row * ChunkSize + Column]);
+		}
+	}
+}
@@ -0,0 +1,101 @@
+// Copyright Chris Sixsmith 2020.
+
+#pragma once
+
+#include "Libs.h"
+#include "2DPositioning.h"
+#include "Variables.h"
+
+/**
+ * Node grid.
+ * Which node is in each grid cell of a function. The grid is infinite and mostly empty, so it is stored in square chunks, and only chunks with something in them exist.
+ * - Chunks are found through a flat open addressed map keyed by chunk position, so looking up a cell is one probe sequence and an array index.
+ * - Each chunk keeps a bit mask of the occupied cells in each row, so area queries skip empty rows and cells rather than looking at every cell in the area.
+ * - A chunk is freed as soon as its last cell is emptied.
+ */
+class NodeGrid
+{
+public:
+	NodeGrid() = default;
+
+	// Non copyable!
+	NodeGrid(const NodeGrid&) = delete;
+	NodeGrid& operator=(const NodeGrid&) = delete;
+
+	/** Returns the handle in the given cell. Invalid if the cell is empty. */
+	NodeHandle Get(const Point& Cell) const;
+
+	/** Puts a handle in the given cell, replacing whatever was there. */
+	void Set(const Point& Cell, const NodeHandle& Handle);
+
+	/** Empties the given cell. */
+	void Erase(const Point& Cell);
+
+	/** Empties every cell. */
+	void Clear();
+
+	/** Returns how many cells are occupied. */
+	int GetCount() const { return CellCount; }
+
+	/**
+	 * Calls a function with every occupied cell between Min and Max (inclusive), in no particular order.
+	 * The cost goes with the number of cells found (and rows of chunks looked at), not the size of the area.
+	 */
+	void ForEachInArea(const Point& Min, const Point& Max, const function<void(const Point& Cell, const NodeHandle& Handle)>& CellFunction) const;
+
+public:
+	/** Chunks are ChunkSize cells square. Each row of a chunk has to fit in a 32 bit mask. */
+	static constexpr int ChunkSize = 32;
+
+private:
+	struct Chunk
+	{
+		/** The chunk's position, in chunks. */
+		Point Key;
+
+		/** Which cells in each row are occupied. Bit N is column N. */
+		uint32_t RowMasks[ChunkSize] = {};
+
+		NodeHandle Cells[ChunkSize * ChunkSize];
+
+		int Count = 0;
+	};
+
+	/** An entry in the chunk map. Entries with no chunk are free. */
+	struct ChunkMapEntry
+	{
+		Point Key;
+		int ChunkIndex = -1;
+	};
+
+	/** Returns the position of the chunk a cell is in, rounding towards negative infinity. */
+	static Point GetChunkKey(const Point& Cell);
+
+	/** Returns the chunk with the given key, or null if there isn't one. */
+	const Chunk* FindChunk(const Point& Key) const;
+	Chunk* FindChunk(const Point& Key) { return const_cast<Chunk*>(static_cast<const NodeGrid*>(this)->FindChunk(Key)); }
+
+	/** Returns the map entry for the given key, or the free entry where it would go. */
+	size_t FindEntry(const Point& Key) const;
+
+	/** Returns the chunk with the given key, creating it if it doesn't exist. */
+	Chunk& FindOrAddChunk(const Point& Key);
+
+	/** Frees the chunk with the given key. It must be empty. */
+	void RemoveChunk(const Point& Key);
+
+	/** Doubles the size of the chunk map and puts every chunk back in it. */
+	void GrowMap();
+
+	/** Calls the function with every occupied cell in the chunk that is also between Min and Max. */
+	static void ForEachInChunk(const Chunk& SearchChunk, const Point& Min, const Point& Max, const function<void(const Point& Cell, const NodeHandle& Handle)>& CellFunction);
+
+private:
+	/** The chunk map. Its size is always a power of 2, and it's never more than half full, so probe sequences stay short. */
+	vector<ChunkMapEntry> ChunkMap;
+
+	/** Every chunk, in no particular order. Removing one moves the last one into its place. */
+	vector<unique_ptr<Chunk>> Chunks;
+
+	int CellCount = 0;
+};
@@ -25,4 +25,4 @@ DECLARE_NODE_CUSTOMNAME(BitwiseOr, Node_BinaryOperator<BinaryOperatorTraits_Bitw
 DECLARE_NODE_CUSTOMNAME(BitwiseXOr, Node_BinaryOperator<BinaryOperatorTraits_BitwiseXOr>);
 
 DECLARE_NODE_CUSTOMNAME(Not, Node_UnaryOperator<UnaryOperatorTraits_Not>);
-DECLARE_NODE_CUSTOMNAME(BitwiseNot, Node_UnaryOperator<UnaryOperatorTraits_Not>);
+DECLARE_NODE_CUSTOMNAME(BitwiseNot, Node_UnaryOperator<UnaryOperatorTraits_BitwiseNot>);
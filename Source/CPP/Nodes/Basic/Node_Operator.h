@@ -3,134 +3,358 @@
 #pragma once
 
 #include "Nodes/Nodes.h"
+#include "Compiler/EmitContext.h"
+#include "Compiler/EmitSink.h"
+#include "Compiler/ConstantValue.h"
+
+#if !IS_HEADLESS
 #include "Alchemist.h"
 #include "Resources/Resources.h"
 #include "Resources/Resource_Font.h"
+#endif
+
+/**
+ * Binary operator traits.
+ * Each operator's traits hide whichever of these defaults they can do better.
+ * Identities let the operator be left out altogether (i.e. X + 0 is emitted as X). That also leaves out the type error the operator would have raised had X not been a number.
+ */
+class BinaryOperatorTraits
+{
+public:
+	/** Works out the operator's result at compile time. Returns false if it can't be (the types are wrong, or it would fail or overflow). */
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out) { return false; }
+
+	/** Returns whether this value on the left gives back the right hand side unchanged. */
+	static bool IsLeftIdentity(const ConstantValue& Value) { return false; }
 
-class BinaryOperatorTraits_Add
+	/** Returns whether this value on the right gives back the left hand side unchanged. */
+	static bool IsRightIdentity(const ConstantValue& Value) { return false; }
+};
+
+class BinaryOperatorTraits_Add : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Add";
 	static inline string SymbolChar = "+";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		int64_t Result;
+
+		if (LHS.ValueType != Type::Integer || RHS.ValueType != Type::Integer || !ConstantValue::AddIntegers(LHS.Integer, RHS.Integer, Result))
+		{
+			return false;
+		}
+
+		Out = ConstantValue::MakeInteger(Result);
+		return true;
+	}
+
+	static bool IsLeftIdentity(const ConstantValue& Value) { return Value.IsInteger(0); }
+	static bool IsRightIdentity(const ConstantValue& Value) { return Value.IsInteger(0); }
 };
 
-class BinaryOperatorTraits_Subtract
+class BinaryOperatorTraits_Subtract : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Subtract";
 	static inline string SymbolChar = "-";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		int64_t Result;
+
+		if (LHS.ValueType != Type::Integer || RHS.ValueType != Type::Integer || !ConstantValue::SubtractIntegers(LHS.Integer, RHS.Integer, Result))
+		{
+			return false;
+		}
+
+		Out = ConstantValue::MakeInteger(Result);
+		return true;
+	}
+
+	static bool IsRightIdentity(const ConstantValue& Value) { return Value.IsInteger(0); }
 };
 
-class BinaryOperatorTraits_Multiply
+class BinaryOperatorTraits_Multiply : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Multiply";
 	static inline string SymbolChar = "*";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		int64_t Result;
+
+		if (LHS.ValueType != Type::Integer || RHS.ValueType != Type::Integer || !ConstantValue::MultiplyIntegers(LHS.Integer, RHS.Integer, Result))
+		{
+			return false;
+		}
+
+		Out = ConstantValue::MakeInteger(Result);
+		return true;
+	}
+
+	// X * 0 isn't folded to 0, since X might be a float (giving 0.0) or a call that needs to happen.
+	static bool IsLeftIdentity(const ConstantValue& Value) { return Value.IsInteger(1); }
+	static bool IsRightIdentity(const ConstantValue& Value) { return Value.IsInteger(1); }
 };
 
-class BinaryOperatorTraits_Divide
+// Always gives a float, which constants can't hold yet, so it's never folded.
+class BinaryOperatorTraits_Divide : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Divide";
 	static inline string SymbolChar = "/";
 };
 
-class BinaryOperatorTraits_Remainder
+class BinaryOperatorTraits_Remainder : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Remainder";
 	static inline string SymbolChar = "rem";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		// Dividing by zero is left to fail at runtime.
+		if (LHS.ValueType != Type::Integer || RHS.ValueType != Type::Integer || RHS.Integer == 0)
+		{
+			return false;
+		}
+
+		// C++ rem takes the sign of the dividend, same as Erlang. Only INT64_MIN rem -1 needs help, as it overflows on the way.
+		Out = ConstantValue::MakeInteger(RHS.Integer == -1 ? 0 : LHS.Integer % RHS.Integer);
+		return true;
+	}
 };
 
-class BinaryOperatorTraits_DivideRounded
+class BinaryOperatorTraits_DivideRounded : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Divide (Rounded)";
 	static inline string SymbolChar = "div";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		if (LHS.ValueType != Type::Integer || RHS.ValueType != Type::Integer || RHS.Integer == 0 || (LHS.Integer == INT64_MIN && RHS.Integer == -1))
+		{
+			return false;
+		}
+
+		// Both round towards zero.
+		Out = ConstantValue::MakeInteger(LHS.Integer / RHS.Integer);
+		return true;
+	}
+
+	static bool IsRightIdentity(const ConstantValue& Value) { return Value.IsInteger(1); }
 };
 
-class BinaryOperatorTraits_Equal
+// Comparisons work on any two values, in Erlang's term order.
+
+class BinaryOperatorTraits_Equal : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Equal";
 	static inline string SymbolChar = "==";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		Out = ConstantValue::MakeBoolean(ConstantValue::Compare(LHS, RHS) == 0);
+		return true;
+	}
 };
 
-class BinaryOperatorTraits_NotEqual
+class BinaryOperatorTraits_NotEqual : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Not Equal";
 	static inline string SymbolChar = "/=";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		Out = ConstantValue::MakeBoolean(ConstantValue::Compare(LHS, RHS) != 0);
+		return true;
+	}
 };
 
-class BinaryOperatorTraits_Greater
+class BinaryOperatorTraits_Greater : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Greater";
 	static inline string SymbolChar = ">";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		Out = ConstantValue::MakeBoolean(ConstantValue::Compare(LHS, RHS) > 0);
+		return true;
+	}
 };
 
-class BinaryOperatorTraits_GreaterEqual
+class BinaryOperatorTraits_GreaterEqual : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Greater or Equal";
 	static inline string SymbolChar = ">=";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		Out = ConstantValue::MakeBoolean(ConstantValue::Compare(LHS, RHS) >= 0);
+		return true;
+	}
 };
 
-class BinaryOperatorTraits_Less
+class BinaryOperatorTraits_Less : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Less";
 	static inline string SymbolChar = "<";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		Out = ConstantValue::MakeBoolean(ConstantValue::Compare(LHS, RHS) < 0);
+		return true;
+	}
 };
 
-class BinaryOperatorTraits_LessEqual
+class BinaryOperatorTraits_LessEqual : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Less or Equal";
 	static inline string SymbolChar = "=<";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		Out = ConstantValue::MakeBoolean(ConstantValue::Compare(LHS, RHS) <= 0);
+		return true;
+	}
 };
 
-class BinaryOperatorTraits_And
+// and, or and xor only take booleans. There's no short-circuiting (that's andalso and orelse), so false and X still has to evaluate X.
+
+class BinaryOperatorTraits_And : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "And";
 	static inline string SymbolChar = "and";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		if (LHS.ValueType != Type::Atom || RHS.ValueType != Type::Atom)
+		{
+			return false;
+		}
+
+		Out = ConstantValue::MakeBoolean(LHS.Boolean && RHS.Boolean);
+		return true;
+	}
+
+	static bool IsLeftIdentity(const ConstantValue& Value) { return Value.IsBoolean(true); }
+	static bool IsRightIdentity(const ConstantValue& Value) { return Value.IsBoolean(true); }
 };
 
-class BinaryOperatorTraits_Or
+class BinaryOperatorTraits_Or : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Or";
 	static inline string SymbolChar = "or";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		if (LHS.ValueType != Type::Atom || RHS.ValueType != Type::Atom)
+		{
+			return false;
+		}
+
+		Out = ConstantValue::MakeBoolean(LHS.Boolean || RHS.Boolean);
+		return true;
+	}
+
+	static bool IsLeftIdentity(const ConstantValue& Value) { return Value.IsBoolean(false); }
+	static bool IsRightIdentity(const ConstantValue& Value) { return Value.IsBoolean(false); }
 };
 
-class BinaryOperatorTraits_XOr
+class BinaryOperatorTraits_XOr : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "XOr";
 	static inline string SymbolChar = "xor";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		if (LHS.ValueType != Type::Atom || RHS.ValueType != Type::Atom)
+		{
+			return false;
+		}
+
+		Out = ConstantValue::MakeBoolean(LHS.Boolean != RHS.Boolean);
+		return true;
+	}
+
+	static bool IsLeftIdentity(const ConstantValue& Value) { return Value.IsBoolean(false); }
+	static bool IsRightIdentity(const ConstantValue& Value) { return Value.IsBoolean(false); }
 };
 
-class BinaryOperatorTraits_BitwiseAnd
+class BinaryOperatorTraits_BitwiseAnd : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Bitwise And";
 	static inline string SymbolChar = "band";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		if (LHS.ValueType != Type::Integer || RHS.ValueType != Type::Integer)
+		{
+			return false;
+		}
+
+		Out = ConstantValue::MakeInteger(LHS.Integer & RHS.Integer);
+		return true;
+	}
+
+	static bool IsLeftIdentity(const ConstantValue& Value) { return Value.IsInteger(-1); }
+	static bool IsRightIdentity(const ConstantValue& Value) { return Value.IsInteger(-1); }
 };
 
-class BinaryOperatorTraits_BitwiseOr
+class BinaryOperatorTraits_BitwiseOr : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Bitwise Or";
 	static inline string SymbolChar = "bor";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		if (LHS.ValueType != Type::Integer || RHS.ValueType != Type::Integer)
+		{
+			return false;
+		}
+
+		Out = ConstantValue::MakeInteger(LHS.Integer | RHS.Integer);
+		return true;
+	}
+
+	static bool IsLeftIdentity(const ConstantValue& Value) { return Value.IsInteger(0); }
+	static bool IsRightIdentity(const ConstantValue& Value) { return Value.IsInteger(0); }
 };
 
-class BinaryOperatorTraits_BitwiseXOr
+class BinaryOperatorTraits_BitwiseXOr : public BinaryOperatorTraits
 {
 public:
 	static inline string Name = "Bitwise XOr";
 	static inline string SymbolChar = "bxor";
+
+	static bool Evaluate(const ConstantValue& LHS, const ConstantValue& RHS, ConstantValue& Out)
+	{
+		if (LHS.ValueType != Type::Integer || RHS.ValueType != Type::Integer)
+		{
+			return false;
+		}
+
+		Out = ConstantValue::MakeInteger(LHS.Integer ^ RHS.Integer);
+		return true;
+	}
+
+	static bool IsLeftIdentity(const ConstantValue& Value) { return Value.IsInteger(0); }
+	static bool IsRightIdentity(const ConstantValue& Value) { return Value.IsInteger(0); }
 };
 
 
@@ -150,9 +374,9 @@ public:
 	}
 	
 	// Node interface.
-	virtual shared_ptr<Node> Clone() const override
+	virtual shared_ptr<Node> Clone(const shared_ptr<NodePool>& Pool = nullptr) const override
 	{
-		return make_shared<Node_BinaryOperator<OperatorTraits>>();
+		return MakeNode<Node_BinaryOperator<OperatorTraits>>(Pool, *this);
 	}
 	
 	virtual string GetDisplayName() const override
@@ -165,6 +389,7 @@ public:
 		return "Operators";
 	}
 	
+#if !IS_HEADLESS
 	virtual void Draw(const Alchemist* Instance, const Point& Position, bool IsPreview = false) const override
 	{
 		Node::Draw(Instance, Position, IsPreview);
@@ -172,75 +397,137 @@ public:
 		shared_ptr<Resource_Font> Font = Instance->GetResourceManager()->GetResource<Resource_Font>("Font.ttf");
 
 		int ValueTextSize = max(8, 30 - (8 * (max((int)OperatorTraits::SymbolChar.size() - 2, 0))));
-		SDL_Texture* Tex = Font->GetStringTexture(OperatorTraits::SymbolChar, ValueTextSize);
 		Size Siz = Font->GetStringScreenSize(OperatorTraits::SymbolChar, ValueTextSize);
 
-		SDL_SetTextureColorMod(Tex, 0, 0, 0);
+		Font->DrawString(OperatorTraits::SymbolChar, Point(Position.X + 32 - (Siz.X / 2), Position.Y + 32 - (Siz.Y / 2)), ValueTextSize);
+	}
+#endif
 
-		SDL_Rect TexDestRect
+	virtual bool EmitInternal(EmitSink& Output, EmitContext& Context) override
+	{
+		Node* LHS = GetConnector(0);
+		Node* RHS = GetConnector(1);
+
+		// If one side is an identity (i.e. the 0 in X + 0), only the other side is needed.
+		if (LHS && RHS)
 		{
-			Position.X + 32 - (Siz.X / 2),
-			Position.Y + 32 - (Siz.Y / 2),
-			Siz.X,
-			Siz.Y
-		};
+			ConstantValue Value;
 
-		SDL_RenderCopy(Instance->GetRenderer(), Tex, NULL, &TexDestRect);
-	}
+			if (LHS->Evaluate(Context, Value) && OperatorTraits::IsLeftIdentity(Value))
+			{
+				return RHS->Emit(Output, Context);
+			}
+
+			if (RHS->Evaluate(Context, Value) && OperatorTraits::IsRightIdentity(Value))
+			{
+				return LHS->Emit(Output, Context);
+			}
+		}
 
-	virtual bool EmitInternal(string& Output, vector<CompilationProblem>& Problems, vector<shared_ptr<Node>> Path) override
-	{
 		bool bLHS = false;
 		bool bRHS = false;
 
 		Output += "(";
 		
-		if(shared_ptr<Node> LHS = GetConnector(0))
+		if(LHS)
 		{
-			if (LHS->Emit(Output, Problems, Path))
+			if (LHS->Emit(Output, Context))
 			{
 				bLHS = true;
 			}
 		}
 		else
 		{
-			Problems.push_back(CompilationProblem{ shared_from_this(), "Missing LHS expression." });
+			Context.Problems.push_back(CompilationProblem{ shared_from_this(), "Missing LHS expression." });
 		}
 
-		Output += " " + OperatorTraits::SymbolChar + " ";
+		Output += " ";
+		Output += OperatorTraits::SymbolChar;
+		Output += " ";
 		
-		if (shared_ptr<Node> RHS = GetConnector(1))
+		if (RHS)
 		{
-			if (RHS->Emit(Output, Problems, Path))
+			if (RHS->Emit(Output, Context))
 			{
 				bRHS = true;
 			}
 		}
 		else
 		{
-			Problems.push_back(CompilationProblem{ shared_from_this(), "Missing RHS expression." });
+			Context.Problems.push_back(CompilationProblem{ shared_from_this(), "Missing RHS expression." });
 		}
 
 		Output += ")";
 		
 		return bLHS && bRHS;
 	}
+
+	virtual bool EvaluateInternal(EmitContext& Context, ConstantValue& Out) override
+	{
+		Node* LHS = GetConnector(0);
+		Node* RHS = GetConnector(1);
+
+		ConstantValue LHSValue;
+		ConstantValue RHSValue;
+
+		return LHS && RHS && LHS->Evaluate(Context, LHSValue) && RHS->Evaluate(Context, RHSValue) && OperatorTraits::Evaluate(LHSValue, RHSValue, Out);
+	}
 	// End of Node interface.
 };
 
 
-class UnaryOperatorTraits_Not
+/**
+ * Unary operator traits.
+ * Each operator's traits hide whichever of these defaults they can do better.
+ */
+class UnaryOperatorTraits
+{
+public:
+	/** Works out the operator's result at compile time. Returns false if it can't be. */
+	static bool Evaluate(const ConstantValue& Input, ConstantValue& Out) { return false; }
+
+	/** Whether applying the operator twice gives back the original value (i.e. not not X), so both can be left out. */
+	static inline bool IsInvolution = false;
+};
+
+class UnaryOperatorTraits_Not : public UnaryOperatorTraits
 {
 public:
 	static inline string Name = "Not";
 	static inline string SymbolChar = "not";
+
+	static bool Evaluate(const ConstantValue& Input, ConstantValue& Out)
+	{
+		if (Input.ValueType != Type::Atom)
+		{
+			return false;
+		}
+
+		Out = ConstantValue::MakeBoolean(!Input.Boolean);
+		return true;
+	}
+
+	static inline bool IsInvolution = true;
 };
 
-class BinaryOperatorTraits_BitwiseNot
+class UnaryOperatorTraits_BitwiseNot : public UnaryOperatorTraits
 {
 public:
 	static inline string Name = "Bitwise Not";
 	static inline string SymbolChar = "bnot";
+
+	static bool Evaluate(const ConstantValue& Input, ConstantValue& Out)
+	{
+		if (Input.ValueType != Type::Integer)
+		{
+			return false;
+		}
+
+		Out = ConstantValue::MakeInteger(~Input.Integer);
+		return true;
+	}
+
+	static inline bool IsInvolution = true;
 };
 
 
@@ -259,9 +546,9 @@ public:
 	}
 
 	// Node interface.
-	virtual shared_ptr<Node> Clone() const override
+	virtual shared_ptr<Node> Clone(const shared_ptr<NodePool>& Pool = nullptr) const override
 	{
-		return make_shared<Node_UnaryOperator<OperatorTraits>>();
+		return MakeNode<Node_UnaryOperator<OperatorTraits>>(Pool, *this);
 	}
 
 	virtual string GetDisplayName() const override
@@ -274,6 +561,7 @@ public:
 		return "Operators";
 	}
 
+#if !IS_HEADLESS
 	virtual void Draw(const Alchemist* Instance, const Point& Position, bool IsPreview = false) const override
 	{
 		Node::Draw(Instance, Position, IsPreview);
@@ -281,45 +569,59 @@ public:
 		shared_ptr<Resource_Font> Font = Instance->GetResourceManager()->GetResource<Resource_Font>("Font.ttf");
 
 		int ValueTextSize = max(8, 30 - (8 * (max((int)OperatorTraits::SymbolChar.size() - 2, 0))));
-		SDL_Texture* Tex = Font->GetStringTexture(OperatorTraits::SymbolChar, ValueTextSize);
 		Size Siz = Font->GetStringScreenSize(OperatorTraits::SymbolChar, ValueTextSize);
 
-		SDL_SetTextureColorMod(Tex, 0, 0, 0);
+		Font->DrawString(OperatorTraits::SymbolChar, Point(Position.X + 32 - (Siz.X / 2), Position.Y + 32 - (Siz.Y / 2)), ValueTextSize);
+	}
+#endif
 
-		SDL_Rect TexDestRect
+	virtual bool EmitInternal(EmitSink& Output, EmitContext& Context) override
+	{
+		// not not X is just X. The inner operator can only be skipped if it wasn't bound to a variable, since then it's emitted on its own.
+		if (OperatorTraits::IsInvolution)
 		{
-			Position.X + 32 - (Siz.X / 2),
-			Position.Y + 32 - (Siz.Y / 2),
-			Siz.X,
-			Siz.Y
-		};
+			Node_UnaryOperator<OperatorTraits>* Inner = dynamic_cast<Node_UnaryOperator<OperatorTraits>*>(GetConnector(0));
 
-		SDL_RenderCopy(Instance->GetRenderer(), Tex, NULL, &TexDestRect);
-	}
+			if (Inner && Context.Bindings.find(Inner) == Context.Bindings.end())
+			{
+				if (Node* InnerInput = Inner->GetConnector(0))
+				{
+					return InnerInput->Emit(Output, Context);
+				}
+			}
+		}
 
-	virtual bool EmitInternal(string& Output, vector<CompilationProblem>& Problems, vector<shared_ptr<Node>> Path) override
-	{
 		bool bInput = false;
 
 		Output += "(";
 
-		Output += OperatorTraits::SymbolChar + " ";
+		Output += OperatorTraits::SymbolChar;
+		Output += " ";
 
-		if (shared_ptr<Node> Input = GetConnector(1))
+		if (Node* Input = GetConnector(0))
 		{
-			if (Input->Emit(Output, Problems, Path))
+			if (Input->Emit(Output, Context))
 			{
 				bInput = true;
 			}
 		}
 		else
 		{
-			Problems.push_back(CompilationProblem{ shared_from_this(), "Missing Input expression." });
+			Context.Problems.push_back(CompilationProblem{ shared_from_this(), "Missing Input expression." });
 		}
 
 		Output += ")";
 
 		return bInput;
 	}
+
+	virtual bool EvaluateInternal(EmitContext& Context, ConstantValue& Out) override
+	{
+		Node* Input = GetConnector(0);
+
+		ConstantValue InputValue;
+
+		return Input && Input->Evaluate(Context, InputValue) && OperatorTraits::Evaluate(InputValue, Out);
+	}
 	// End of Node interface.
 };
@@ -0,0 +1,65 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "NodePool.h"
+
+void* NodePool::Allocate(size_t Bytes)
+{
+	if (Bytes > MaxBlockSize)
+	{
+		return ::operator new(Bytes);
+	}
+
+	size_t SizeClass = GetSizeClass(Bytes);
+
+	lock_guard<mutex> Lock(PoolMutex);
+
+	// Reuse a freed block of the same size if there is one...
+	if (FreeBlock* Reused = FreeLists[SizeClass])
+	{
+		FreeLists[SizeClass] = Reused->Next;
+		return Reused;
+	}
+
+	// ...otherwise take the next bit of the last chunk, starting a new one if it's full.
+	size_t BlockSize = SizeClass * Alignment;
+
+	if (ChunkUsed + BlockSize > ChunkSize)
+	{
+		Chunks.push_back(make_unique<max_align_t[]>(ChunkSize / sizeof(max_align_t)));
+		ChunkUsed = 0;
+	}
+
+	void* Block = reinterpret_cast<char*>(Chunks.back().get()) + ChunkUsed;
+	ChunkUsed += BlockSize;
+
+	return Block;
+}
+
+void NodePool::Free(void* Block, size_t Bytes)
+{
+	if (!Block)
+	{
+		return;
+	}
+
+	if (Bytes > MaxBlockSize)
+	{
+		::operator delete(Block);
+		return;
+	}
+
+	size_t SizeClass = GetSizeClass(Bytes);
+
+	lock_guard<mutex> Lock(PoolMutex);
+
+	FreeBlock* Freed = static_cast<FreeBlock*>(Block);
+	Freed->Next = FreeLists[SizeClass];
+	FreeLists[SizeClass] = Freed;
+}
+
+size_t NodePool::GetReservedSize() const
+{
+	lock_guard<mutex> Lock(PoolMutex);
+
+	return Chunks.size() * ChunkSize;
+}
@@ -0,0 +1,103 @@
+// Copyright Chris Sixsmith 2020.
+
+#pragma once
+
+#include "Libs.h"
+
+/**
+ * Node pool.
+ * Memory for the nodes of one function. Nodes (and their reference counts) are carved out of large chunks rather than each being its own heap allocation,
+ * so the nodes of a function sit next to each other in memory.
+ * - Freed blocks go on a free list for their size and are handed out again to the next node of that size.
+ * - Chunks are only released when the pool is. Every node allocated from the pool keeps it alive, so it can outlive its function.
+ * - Nodes can be released from any thread (i.e. when the compile thread drops a snapshot), so the pool locks around each allocation.
+ */
+class NodePool
+{
+public:
+	NodePool() = default;
+
+	// Non copyable!
+	NodePool(const NodePool&) = delete;
+	NodePool& operator=(const NodePool&) = delete;
+
+	/** Returns a block of at least the given size, aligned for any node. */
+	void* Allocate(size_t Bytes);
+
+	/** Gives a block back. Bytes must be the size it was allocated with. */
+	void Free(void* Block, size_t Bytes);
+
+	/** Returns how many bytes of chunks the pool has taken from the heap. */
+	size_t GetReservedSize() const;
+
+public:
+	/** Every block is a multiple of this, which is enough alignment for anything. */
+	static constexpr size_t Alignment = alignof(max_align_t);
+
+	/** Blocks bigger than this come straight from the heap. No node is anywhere near it. */
+	static constexpr size_t MaxBlockSize = 1024;
+
+	static constexpr size_t ChunkSize = 16 * 1024;
+
+private:
+	struct FreeBlock
+	{
+		FreeBlock* Next;
+	};
+
+	/** Returns the free list index for blocks of the given size. */
+	static size_t GetSizeClass(size_t Bytes) { return (Bytes + Alignment - 1) / Alignment; }
+
+private:
+	mutable mutex PoolMutex;
+
+	vector<unique_ptr<max_align_t[]>> Chunks;
+	size_t ChunkUsed = ChunkSize; // bytes handed out from the last chunk
+
+	vector<FreeBlock*> FreeLists = vector<FreeBlock*>(MaxBlockSize / Alignment + 1, nullptr);
+};
+
+/**
+ * Allocator that takes memory from a node pool. Holds on to the pool, so it lives as long as anything allocated from it.
+ * Use MakeNode() rather than this directly.
+ */
+template<class T>
+class NodeAllocator
+{
+public:
+	using value_type = T;
+
+	explicit NodeAllocator(shared_ptr<NodePool> PoolIn) : Pool(move(PoolIn)) {}
+
+	template<class U>
+	NodeAllocator(const NodeAllocator<U>& Other) : Pool(Other.Pool) {}
+
+	T* allocate(size_t Count) { return static_cast<T*>(Pool->Allocate(Count * sizeof(T))); }
+	void deallocate(T* Block, size_t Count) { Pool->Free(Block, Count * sizeof(T)); }
+
+	template<class U>
+	bool operator==(const NodeAllocator<U>& Other) const { return Pool == Other.Pool; }
+
+	template<class U>
+	bool operator!=(const NodeAllocator<U>& Other) const { return Pool != Other.Pool; }
+
+private:
+	shared_ptr<NodePool> Pool;
+
+	template<class U>
+	friend class NodeAllocator;
+};
+
+/** Creates a node in the given pool, or on the heap if there's no pool. */
+template<class NodeClass, class... ArgTypes>
+shared_ptr<NodeClass> MakeNode(const shared_ptr<NodePool>& Pool, ArgTypes&&... Args)
+{
+	static_assert(alignof(NodeClass) <= NodePool::Alignment, "Node is too strictly aligned for the pool.");
+
+	if (!Pool)
+	{
+		return make_shared<NodeClass>(forward<ArgTypes>(Args)...);
+	}
+
+	return allocate_shared<NodeClass>(NodeAllocator<NodeClass>(Pool), forward<ArgTypes>(Args)...);
+}
@@ -1,10 +1,17 @@
 // Copyright Chris Sixsmith 2020.
 
 #include "Nodes.h"
+#include "Special/Node_UserDefined.h"
+#include "Module/Function.h"
+#include "Module/Module.h"
+#include "Compiler/EmitContext.h"
+#include "Compiler/EmitSink.h"
+
+#if !IS_HEADLESS
 #include "DrawShapes.h"
 #include "Alchemist.h"
 #include "Resources/Resource_Image.h"
-#include "Special/Node_UserDefined.h"
+#endif
 
 Node::Node()
 	: ID(-1)
@@ -19,7 +26,7 @@ bool Node::GetArgumentIsPattern(int Argument) const
 	return ArgumentData[Argument].IsPattern;
 }
 
-string Node::GetArgumentName(int Argument) const
+const string& Node::GetArgumentName(int Argument) const
 {
 	assert(Argument >= 0 && Argument < ArgumentData.size());
 	return ArgumentData[Argument].ArgumentName;
@@ -37,61 +44,234 @@ int Node::GetArgumentIndexFromName(const string& ArgumentName) const
 	return -1;
 }
 
-shared_ptr<Node> Node::GetConnector(int Argument) const
+Node* Node::GetConnector(int Argument) const
 {
 	assert(Argument >= 0 && Argument < ArgumentData.size());
-	return ArgumentData[Argument].Connector.lock();
+
+	const NodeHandle& Connector = ArgumentData[Argument].Connector;
+
+	if (!NodeFunction || !Connector.IsValid())
+	{
+		return nullptr;
+	}
+
+	return NodeFunction->GetNode(Connector);
 }
 
-bool Node::SetConnector(const shared_ptr<Node>& From, int Argument)
+bool Node::SetConnector(const Node* From, int Argument)
 {
 	// Still counts as an assertion failure if we provide an invalid index
 	assert(Argument >= 0 && Argument < ArgumentData.size());
 
+	if (!From)
+	{
+		DisconnectConnector(Argument);
+		return true;
+	}
+
+	// Connectors are handles into the function's node slots, so they can't point anywhere else.
+	Node* Source = NodeFunction && From->NodeFunction == NodeFunction ? NodeFunction->GetNode(From->Handle) : nullptr;
+
+	if (Source != From)
+	{
+		return false;
+	}
+
 	// TODO check type match
 	
 	// Success!
-	ArgumentData[Argument].Connector = From;
+	if (IsPlaced())
+	{
+		if (Node* OldSource = GetConnector(Argument))
+		{
+			OldSource->RemoveConsumer(Handle, Argument);
+		}
+
+		Source->Consumers.push_back(NodeConsumer{ Handle, Argument });
+		NodeFunction->TrackConnector(*Source, *this, Argument);
+	}
+
+	ArgumentData[Argument].Connector = From->Handle;
+	MarkFunctionDirty();
+
 	return true;
 }
 
 void Node::DisconnectConnector(int Argument)
 {
 	assert(Argument >= 0 && Argument < ArgumentData.size());
-	ArgumentData[Argument].Connector.reset();
+
+	if (IsPlaced())
+	{
+		if (Node* OldSource = GetConnector(Argument))
+		{
+			OldSource->RemoveConsumer(Handle, Argument);
+		}
+	}
+
+	ArgumentData[Argument].Connector = NodeHandle();
+	MarkFunctionDirty();
+}
+
+bool Node::IsPlaced() const
+{
+	return NodeFunction && NodeFunction->GetNode(Handle) == this;
+}
+
+void Node::ClearConnectors()
+{
+	for (NodeArgumentData& Argument : ArgumentData)
+	{
+		Argument.Connector = NodeHandle();
+	}
+}
+
+void Node::LinkInputs()
+{
+	for (int i = 0; i < GetNumArguments(); i++)
+	{
+		if (Node* Source = GetConnector(i))
+		{
+			Source->Consumers.push_back(NodeConsumer{ Handle, i });
+		}
+		else
+		{
+			ArgumentData[i].Connector = NodeHandle();
+		}
+	}
+}
+
+void Node::UnlinkInputs()
+{
+	for (int i = 0; i < GetNumArguments(); i++)
+	{
+		if (Node* Source = GetConnector(i))
+		{
+			Source->RemoveConsumer(Handle, i);
+		}
+	}
+}
+
+void Node::UnlinkConsumers()
+{
+	for (const NodeConsumer& Entry : Consumers)
+	{
+		if (Node* ConsumerNode = NodeFunction->GetNode(Entry.Consumer))
+		{
+			ConsumerNode->ArgumentData[Entry.Argument].Connector = NodeHandle();
+		}
+
+		NodeFunction->UntrackConnector(Entry.Consumer, Entry.Argument);
+	}
+
+	Consumers.clear();
+}
+
+void Node::RemoveConsumer(const NodeHandle& Consumer, int Argument)
+{
+	for (size_t i = 0; i < Consumers.size(); i++)
+	{
+		if (Consumers[i].Consumer == Consumer && Consumers[i].Argument == Argument)
+		{
+			// Order doesn't matter, so fill the gap with the last entry.
+			Consumers[i] = Consumers.back();
+			Consumers.pop_back();
+
+			NodeFunction->UntrackConnector(Consumer, Argument);
+
+			return;
+		}
+	}
 }
 
 void Node::RegisterArgument(const string& ArgumentName, bool IsPattern)
 {
 	assert(GetArgumentIndexFromName(ArgumentName) == -1);
-	ArgumentData.push_back(NodeArgumentData{ ArgumentName, IsPattern, weak_ptr<Node>() });
+	ArgumentData.push_back(NodeArgumentData{ ArgumentName, IsPattern, NodeHandle() });
 }
 
 void Node::ClearArguments()
 {
+	if (IsPlaced())
+	{
+		UnlinkInputs();
+	}
+
 	ArgumentData.clear();
 	ArgumentLookupTable.clear();
+	MarkFunctionDirty();
 }
 
-bool Node::Emit(string& Output, vector<CompilationProblem>& Problems, vector<shared_ptr<Node>> Path)
+void Node::MarkFunctionDirty()
 {
-	// Check for infinite loop
-	for(shared_ptr<Node> PathNode : Path)
+	if (NodeFunction)
 	{
-		if(PathNode == shared_from_this())
-		{
-			Problems.push_back(CompilationProblem{ shared_from_this(), "Infinite loop detected!" });
-			return false;
-		}
+		NodeFunction->MarkDirty();
+	}
+}
+
+bool Node::Emit(EmitSink& Output, EmitContext& Context)
+{
+	// Shared nodes that were already bound to a variable are just referenced by name
+	auto Bound = Context.Bindings.find(this);
+
+	if (Bound != Context.Bindings.end())
+	{
+		Output += Bound->second.Variable;
+		return Bound->second.Pass;
+	}
+
+	// Nodes on an infinite loop were reported before emitting started. Stop here rather than going round forever.
+	if (Context.CycleNodes.find(this) != Context.CycleNodes.end())
+	{
+		return false;
 	}
 
-	// Add self to path
-	Path.push_back(shared_from_this());
+	// Constant expressions are emitted as their value. Nodes without arguments are already as simple as they can be.
+	ConstantValue Value;
+
+	if (GetNumArguments() > 0 && Evaluate(Context, Value))
+	{
+		Value.Emit(Output);
+		return true;
+	}
 
 	// Call internal emit
-	return EmitInternal(Output, Problems, Path);
+	return EmitInternal(Output, Context);
+}
+
+bool Node::Evaluate(EmitContext& Context, ConstantValue& Out)
+{
+	if (Context.CycleNodes.find(this) != Context.CycleNodes.end())
+	{
+		return false;
+	}
+
+	// Leaves are cheap to evaluate again, so only nodes with arguments are remembered.
+	if (GetNumArguments() == 0)
+	{
+		return EvaluateInternal(Context, Out);
+	}
+
+	auto Found = Context.Constants.find(this);
+
+	if (Found == Context.Constants.end())
+	{
+		ConstantValue Value;
+
+		if (!EvaluateInternal(Context, Value))
+		{
+			Value = ConstantValue();
+		}
+
+		Found = Context.Constants.emplace(this, Value).first;
+	}
+
+	Out = Found->second;
+	return Out.IsKnown();
 }
 
+#if !IS_HEADLESS
 void Node::Draw(const Alchemist* Instance, const Point& Position, bool IsPreview) const
 {
 	shared_ptr<Resource_Image> RingResource = Instance->GetResourceManager()->GetResource<Resource_Image>("NodeRing.png");
@@ -113,6 +293,7 @@ SDL_Rect Node::GetRenderRect(const Point& Position) const
 {
 	return SDL_Rect{Position.X, Position.Y, GridSize, GridSize};
 }
+#endif
 
 
 /////////////////////////////////////////////////////////////////////
@@ -125,18 +306,26 @@ vector<shared_ptr<Node>>& GetStaticNodes()
 	return StaticNodes;
 }
 
+vector<string>& GetStaticNodeNames()
+{
+	static vector<string> StaticNodeNames;
+	return StaticNodeNames;
+}
+
 
 /////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////
 
 
-NodeManager::NodeManager(Alchemist* InstanceIn)
-	: Instance(InstanceIn)
+NodeManager::NodeManager(const Module* UserModuleIn)
+	: UserModule(UserModuleIn)
 {}
 
-shared_ptr<Node> NodeManager::CreateNode(int NodeID) const
+shared_ptr<Node> NodeManager::CreateNode(int NodeID, const shared_ptr<NodePool>& Pool) const
 {
-	return Get(NodeID)->Clone();
+	shared_ptr<Node> Template = Get(NodeID);
+
+	return Template ? Template->Clone(Pool) : nullptr;
 }
 
 shared_ptr<Node> NodeManager::Get(int NodeID) const
@@ -144,104 +333,165 @@ shared_ptr<Node> NodeManager::Get(int NodeID) const
 	if (NodeID >= 0)
 	{
 		// Return from the static nodes list.
-		assert(NodeID < GetStaticNodes().size());
-		return GetStaticNodes()[NodeID];
+		if (NodeID < GetStaticNodes().size())
+		{
+			return GetStaticNodes()[NodeID];
+		}
 	}
 	else
 	{
-		return GetAllUser()[-NodeID];
+		const vector<shared_ptr<Node>>& Users = GetAllUser();
+
+		if (-NodeID <= Users.size())
+		{
+			return Users[-NodeID - 1];
+		}
 	}
 
 	return nullptr;
 }
 
-vector<shared_ptr<Node>> NodeManager::GetAll() const
+const vector<shared_ptr<Node>>& NodeManager::GetAll() const
 {
-	vector<shared_ptr<Node>> Nodes = GetAllStatic();
-	vector<shared_ptr<Node>> UserNodes = GetAllUser();
+	UpdateCache();
 
-	Nodes.insert(Nodes.end(), UserNodes.begin(), UserNodes.end());
-	
-	return Nodes;
+	return AllNodes;
 }
 
-vector<shared_ptr<Node>> NodeManager::GetAll(string Category) const
+const vector<shared_ptr<Node>>& NodeManager::GetAll(const string& Category) const
 {
-	vector<shared_ptr<Node>> All = GetAll();
+	static const vector<shared_ptr<Node>> NoNodes;
 
-	vector<shared_ptr<Node>> Out;
+	UpdateCache();
 
-	for(const shared_ptr<Node>& NodeInstance : All)
-	{
-		if(NodeInstance->GetCategory() == Category)
-		{
-			Out.push_back(NodeInstance);
-		}
-	}
+	auto Found = NodesByCategory.find(Category);
 
-	return Out;
+	return Found != NodesByCategory.end() ? Found->second : NoNodes;
 }
 
-vector<shared_ptr<Node>> NodeManager::GetAllStatic() const
+const vector<shared_ptr<Node>>& NodeManager::GetAllStatic() const
 {
 	return GetStaticNodes();
 }
 
-vector<shared_ptr<Node>> NodeManager::GetAllUser() const
+const vector<shared_ptr<Node>>& NodeManager::GetAllUser() const
+{
+	UpdateCache();
+
+	return UserNodes;
+}
+
+const vector<Category>& NodeManager::GetCategorisedNodes() const
 {
-	vector<shared_ptr<Node>> Out;
-	auto Functions = Instance->GetCurrentModule()->GetFunctions();
+	UpdateCache();
+
+	return Categories;
+}
+
+void NodeManager::UpdateCache() const
+{
+	if (CachedSignatureVersion == UserModule->GetSignatureVersion())
+	{
+		return;
+	}
+
+	CachedSignatureVersion = UserModule->GetSignatureVersion();
+
+	// Keep the user nodes of functions whose arity hasn't changed. Only their IDs might have.
+	unordered_map<const Function*, shared_ptr<Node>> OldUserNodes;
+
+	for (const shared_ptr<Node>& UserNode : UserNodes)
+	{
+		if (shared_ptr<Function> Called = static_pointer_cast<Node_UserDefined>(UserNode)->GetCalledFunction())
+		{
+			OldUserNodes[Called.get()] = UserNode;
+		}
+	}
+
+	UserNodes.clear();
+
+	const vector<shared_ptr<Function>>& Functions = UserModule->GetFunctions();
 	
-	for(int i = 0; i < Functions.size(); i++)
+	for (int i = 0; i < Functions.size(); i++)
 	{
-		shared_ptr<Node> UserNode = make_shared<Node_UserDefined>(Functions[i]);
-		UserNode->ID = -i;
-		
-		Out.push_back(UserNode);
+		auto Found = OldUserNodes.find(Functions[i].get());
+		shared_ptr<Node> UserNode;
+
+		if (Found != OldUserNodes.end() && Found->second->GetNumArguments() == Functions[i]->GetArity())
+		{
+			UserNode = Found->second;
+		}
+		else
+		{
+			UserNode = make_shared<Node_UserDefined>(Functions[i]);
+		}
+
+		UserNode->ID = -(i + 1);
+		UserNodes.push_back(UserNode);
 	}
 
-	return Out;
-}
+	AllNodes = GetStaticNodes();
+	AllNodes.insert(AllNodes.end(), UserNodes.begin(), UserNodes.end());
 
-vector<Category> NodeManager::GetCategorisedNodes() const
-{
-	vector<shared_ptr<Node>> All = GetAll();
+	// Sort everything into categories, in the order they were first seen.
+	Categories.clear();
+	NodesByCategory.clear();
 
-	vector<Category> Out;
 	unordered_map<string, int> CategoryLookup;
 
-	for (shared_ptr<Node> NodeInstance : All)
+	for (const shared_ptr<Node>& NodeInstance : AllNodes)
 	{
-		// Find category ID
 		string CategoryName = NodeInstance->GetCategory();
-		
+
+		NodesByCategory[CategoryName].push_back(NodeInstance);
+
+		// Hidden nodes don't go in any menu.
 		if (CategoryName == "")
 		{
 			continue;
 		}
 
 		auto FoundCategory = CategoryLookup.find(CategoryName);
-		int FoundCategoryId;
 
 		if (FoundCategory == CategoryLookup.end())
 		{
-			// Add a new category.
-			Out.push_back(Category{ CategoryName, {} });
+			Categories.push_back(Category{ CategoryName, {} });
+			FoundCategory = CategoryLookup.emplace(CategoryName, (int)Categories.size() - 1).first;
+		}
 
-			FoundCategoryId = (int)Out.size() - 1;
+		Categories[FoundCategory->second].Nodes.push_back(NodeInstance);
+	}
 
-			CategoryLookup[CategoryName] = FoundCategoryId;			
-		}
-		else
+	// The first node of a class might be a different one now.
+	NodesByType.clear();
+}
+
+shared_ptr<Node> NodeManager::GetByType(const type_index& Type, bool (*IsType)(const Node&)) const
+{
+	UpdateCache();
+
+	auto Found = NodesByType.find(Type);
+
+	if (Found != NodesByType.end())
+	{
+		return Found->second;
+	}
+
+	shared_ptr<Node> FirstOfType;
+
+	for (const shared_ptr<Node>& NodeInstance : AllNodes)
+	{
+		if (IsType(*NodeInstance))
 		{
-			FoundCategoryId = FoundCategory->second;
+			FirstOfType = NodeInstance;
+			break;
 		}
-
-		// Add node to category
-		Out[FoundCategoryId].Nodes.push_back(NodeInstance);
 	}
 
-	return Out;
+	// Classes with no nodes are remembered too.
+	NodesByType.emplace(Type, FirstOfType);
+
+	return FirstOfType;
 }
 
 
@@ -249,8 +499,19 @@ vector<Category> NodeManager::GetCategorisedNodes() const
 /////////////////////////////////////////////////////////////////////
 
 
-NodeRegistrar::NodeRegistrar(const shared_ptr<Node>& NodeType)
+NodeRegistrar::NodeRegistrar(const string& Name, const shared_ptr<Node>& NodeType)
 {
-	NodeType->ID = (int)GetStaticNodes().size();
-	GetStaticNodes().push_back(NodeType);
+	vector<shared_ptr<Node>>& StaticNodes = GetStaticNodes();
+	vector<string>& StaticNodeNames = GetStaticNodeNames();
+
+	size_t Index = lower_bound(StaticNodeNames.begin(), StaticNodeNames.end(), Name) - StaticNodeNames.begin();
+
+	StaticNodeNames.insert(StaticNodeNames.begin() + Index, Name);
+	StaticNodes.insert(StaticNodes.begin() + Index, NodeType);
+
+	// Everything after the new node moved up one.
+	for (size_t i = Index; i < StaticNodes.size(); i++)
+	{
+		StaticNodes[i]->ID = (int)i;
+	}
 }
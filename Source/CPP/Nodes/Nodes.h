@@ -6,9 +6,14 @@
 #include "Variables.h"
 #include "2DPositioning.h"
 #include "CompilationProblem.h"
+#include "NodePool.h"
 
 class Alchemist;
 class Function;
+class Module;
+struct EmitContext;
+struct ConstantValue;
+class EmitSink;
 
 // todo adapt to shared_ptr (i.e. stop using dumb ptr)
 
@@ -27,8 +32,8 @@ class Node : public enable_shared_from_this<Node>
 public:
 	Node();
 
-	/** Makes a copy of this node. */
-	virtual shared_ptr<Node> Clone() const = 0;
+	/** Makes a copy of this node, in the given pool if there is one (see MakeNode). */
+	virtual shared_ptr<Node> Clone(const shared_ptr<NodePool>& Pool = nullptr) const = 0;
 
 	friend class NodeManager;
 	friend class NodeRegistrar;
@@ -54,11 +59,11 @@ public:
 
 
 public:
-	/** Loads the node's data from a file. */
-	virtual void Load(const ifstream& FileStream) {}
+	/** Loads the node's data packet. Only GetDataSize() bytes are available. */
+	virtual void Load(istream& Stream) {}
 
-	/** Saves this node's data to a file. */
-	virtual void Save(const ofstream& FileStream) const {}
+	/** Saves this node's data packet. Must write exactly GetDataSize() bytes. */
+	virtual void Save(ostream& Stream) const {}
 
 	/** Returns the size this node will use for its serialised data packet in an .ALCH file. */
 	virtual size_t GetDataSize() const { return 0; }
@@ -77,7 +82,7 @@ public:
 	bool GetArgumentIsPattern(int Argument) const;
 
 	/** Returns given argument's argument name. */
-	string GetArgumentName(int Argument) const;
+	const string& GetArgumentName(int Argument) const;
 
 	/** Returns false if this node can never be used in an expression. */
 	virtual bool CanBeOperand() const { return true; }
@@ -89,15 +94,27 @@ public:
 	int GetArgumentIndexFromName(const string& ArgumentName) const;
 
 public:
-	/** Returns given argument's connector. */
-	shared_ptr<Node> GetConnector(int Argument) const;
+	/**
+	 * Returns given argument's connector, or null if there isn't one.
+	 * This is a plain lookup in the function's node slots, so it's cheap enough to call on every edge every frame. Use shared_from_this() to keep hold of the node.
+	 */
+	Node* GetConnector(int Argument) const;
 
-	/** Sets given argument's connector, if allowed. */
-	bool SetConnector(const shared_ptr<Node>& From, int Argument);
+	/**
+	 * Sets given argument's connector, if allowed. Passing null disconnects it.
+	 * Both nodes must be placed in the same function.
+	 */
+	bool SetConnector(const Node* From, int Argument);
 
 	/** Destroys a connector. */
 	void DisconnectConnector(int Argument);
 
+	/**
+	 * Returns every argument this node is connected to, in no particular order.
+	 * Kept up to date as connectors change, so finding what uses a node doesn't mean going through the whole function. Empty if the node isn't placed.
+	 */
+	const vector<NodeConsumer>& GetConsumers() const { return Consumers; }
+
 protected:
 	/**
 	 * Registers an argument. Call this in your node class's constructor.
@@ -108,8 +125,31 @@ protected:
 	/** Removes all arguments. */
 	void ClearArguments();
 
+	/** Tells the function containing this node (if any) that it needs to be re-emitted. Call this when changing anything that affects EmitInternal. */
+	void MarkFunctionDirty();
+
+private:
+	/** Returns true if the node is in its function's node slots. Only placed nodes are listed as consumers. */
+	bool IsPlaced() const;
+
+	/** Drops every connector without marking anything dirty. Used when the node leaves its function, as the handles mean nothing anywhere else. */
+	void ClearConnectors();
+
+	/** Lists this node as a consumer of each of its inputs. Inputs that aren't there anymore are dropped. */
+	void LinkInputs();
+
+	/** Takes this node off the consumer list of each of its inputs. */
+	void UnlinkInputs();
+
+	/** Disconnects every argument this node is connected to. */
+	void UnlinkConsumers();
+
+	/** Removes one entry from the consumer list. */
+	void RemoveConsumer(const NodeHandle& Consumer, int Argument);
+
 private:
 	vector<NodeArgumentData> ArgumentData;
+	vector<NodeConsumer> Consumers;
 	unordered_map<string, int> ArgumentLookupTable;
 
 
@@ -119,9 +159,16 @@ private:
 
 
 public:
-	/** Checks for an infinite loop before calling EmitInternal. */
-	bool Emit(string& Output, vector<CompilationProblem>& Problems, vector<shared_ptr<Node>> Path);
+	/**
+	 * Calls EmitInternal, unless the node is on an infinite loop. If the node was bound to a variable earlier in the clause, emits the variable instead.
+	 * Expressions that evaluate to a constant are emitted as the constant.
+	 */
+	bool Emit(EmitSink& Output, EmitContext& Context);
+
+	/** Works out the node's value at compile time, if it can be. Returns false if it depends on anything only known at runtime. */
+	bool Evaluate(EmitContext& Context, ConstantValue& Out);
 	
+#if !IS_HEADLESS
 	/** Draws the node somewhere on-screen. */
 	virtual void Draw(const Alchemist* Instance, const Point& Position, bool IsPreview = false) const;
 
@@ -133,6 +180,7 @@ public:
 	
 	/** Gets the screen rectangle where this node is drawn given a draw position. */
 	virtual SDL_Rect GetRenderRect(const Point& Position) const;
+#endif
 
 	/** Returns the node's ID to the NodeManager that manages it. */
 	int GetID() const { return ID; }
@@ -140,22 +188,32 @@ public:
 	/** Returns the function the node is inside. */
 	Function* GetFunction() const { return NodeFunction; }
 
+	/** Returns the node's handle within its function. Invalid if it isn't on a grid. */
+	NodeHandle GetHandle() const { return Handle; }
+
 	/** Return's the node's cached grid position. */
 	Point GetGridPosition() const { return GridPosition; }
 
 protected:
 	/** Emits this node's Erlang code. Arguably the most important function. */
-	virtual bool EmitInternal(string& Output, vector<CompilationProblem>& Problems, vector<shared_ptr<Node>> Path) = 0;
+	virtual bool EmitInternal(EmitSink& Output, EmitContext& Context) = 0;
+
+	/** Works out the node's value. Override this for nodes that can be evaluated at compile time. */
+	virtual bool EvaluateInternal(EmitContext& Context, ConstantValue& Out) { return false; }
 	
 	/** Triggers when an instance of the node is placed in a function, or the function signature is changed. */
 	virtual void OnFunctionChanged() {}
 
-	/** Triggers when an instance of the node is present in a function while the makeup of the containing Module is changed. */
+	/** Triggers when something the node refers to elsewhere in the module changes (i.e. the signature of the function it calls). See Module::NotifyCallSites. */
 	virtual void OnModuleChanged() {}
+
+	/** Triggers when a clone of the node is made for a copy of its module (i.e. a snapshot). Repoint anything that refers to the old module here. */
+	virtual void OnCopiedToModule(const Module& NewModule) {}
 	
 private:
 	int ID = -1;
-	Function* NodeFunction;
+	Function* NodeFunction = nullptr;
+	NodeHandle Handle;
 	Point GridPosition;
 
 	friend class Module;
@@ -179,68 +237,78 @@ struct Category
  * - All node types registered at compile time are given an ID
  * - New nodes are created by "cloning" a template (all nodes have a Clone function which returns a Node*)
  * - Asking this to create from a negative ID will create a user function call node that calls the given positive ID.
+ * - The user nodes, categories and lookups are cached, and only rebuilt when the module's functions are added, removed, renamed or change arity. Nothing here allocates otherwise.
  */
 class NodeManager
 {
 public:
-	NodeManager(Alchemist* InstanceIn);
+	/** Creates a node manager. User-created nodes call functions in the given module. */
+	NodeManager(const Module* UserModuleIn);
 
 	// Non copyable!
 	NodeManager(const NodeManager&);
 	NodeManager& operator=(const NodeManager&);
 
-	/** Creates a node with the given ID. Remember, positive IDs give the built-in nodes, negative ones give user-created ones. */
-	shared_ptr<Node> CreateNode(int NodeID) const;
+	/**
+	 * Creates a node with the given ID. Remember, positive IDs give the built-in nodes, negative ones give user-created ones. Returns null if there's no such node.
+	 * The node is created in the given pool, if there is one.
+	 */
+	shared_ptr<Node> CreateNode(int NodeID, const shared_ptr<NodePool>& Pool = nullptr) const;
 
 	/** Finds the node matching the given class and creates it. */
 	template<class NodeClass>
-	shared_ptr<NodeClass> CreateNode() const
+	shared_ptr<NodeClass> CreateNode(const shared_ptr<NodePool>& Pool = nullptr) const
 	{
-		return dynamic_pointer_cast<NodeClass>(Get<NodeClass>()->Clone());
+		return dynamic_pointer_cast<NodeClass>(Get<NodeClass>()->Clone(Pool));
 	}
 
-	/** Returns the default object for a node. Don't let the user place this one! */
+	/** Returns the default object for a node, or null if there's no such node. Don't let the user place this one! */
 	shared_ptr<Node> Get(int NodeID) const;
 
 	/** Returns the default object for a node given a class. Don't let the user place this one! */
 	template<class NodeClass>
 	shared_ptr<NodeClass> Get() const
 	{
-		vector<shared_ptr<Node>> AllNodes = GetAll();
-
-		for(const shared_ptr<Node>& NodeInstance : AllNodes)
+		return dynamic_pointer_cast<NodeClass>(GetByType(typeid(NodeClass), [](const Node& NodeInstance)
 		{
-			return dynamic_pointer_cast<NodeClass>(NodeInstance);
-		}
-
-		return nullptr;
+			return dynamic_cast<const NodeClass*>(&NodeInstance) != nullptr;
+		}));
 	}
 
-	/** Returns a vector of every node registered. */
-	vector<shared_ptr<Node>> GetAll() const;
+	/** Returns every node registered. */
+	const vector<shared_ptr<Node>>& GetAll() const;
 
-	/**
-	 * Returns a vector of every node, filtered to a specific category.
-	 * Note that this is slow as it isn't using an acceleration structure yet.
-	 */
-	vector<shared_ptr<Node>> GetAll(string Category) const;
+	/** Returns every node in a specific category. */
+	const vector<shared_ptr<Node>>& GetAll(const string& Category) const;
 
-	/** Returns a vector of every static node. */
-	vector<shared_ptr<Node>> GetAllStatic() const;
+	/** Returns every static node. */
+	const vector<shared_ptr<Node>>& GetAllStatic() const;
 	
-	/** Returns a vector of every user node. */
-	vector<shared_ptr<Node>> GetAllUser() const;
+	/** Returns every user node. The node calling the module's first function has the ID -1, the second -2, and so on. */
+	const vector<shared_ptr<Node>>& GetAllUser() const;
 
-	/**
-	 * Returns all categories that exist.
-	 * Note that this is slow as it isn't using an acceleration structure yet.
-	 */
-	vector<Category> GetCategorisedNodes() const;
+	/** Returns all categories that exist, except the hidden one. */
+	const vector<Category>& GetCategorisedNodes() const;
 	
 	// TODO user function registration.
 
 private:
-	Alchemist* Instance;
+	/** Rebuilds the user nodes, categories and lookups if the module's function signatures changed since they were last built. */
+	void UpdateCache() const;
+
+	/** Returns the first node that is the given class (or inherits it). The answer is kept, so each class is only searched for once per rebuild. */
+	shared_ptr<Node> GetByType(const type_index& Type, bool (*IsType)(const Node&)) const;
+
+private:
+	const Module* UserModule;
+
+	// Everything below is rebuilt when the module's signature version changes.
+	mutable int CachedSignatureVersion = -1;
+	mutable vector<shared_ptr<Node>> UserNodes;
+	mutable vector<shared_ptr<Node>> AllNodes;
+	mutable vector<Category> Categories;
+	mutable unordered_map<string, vector<shared_ptr<Node>>> NodesByCategory;
+	mutable unordered_map<type_index, shared_ptr<Node>> NodesByType;
 };
 
 
@@ -252,8 +320,12 @@ private:
 class NodeRegistrar
 {
 public:
-	NodeRegistrar(const shared_ptr<Node>& NodeType);
+	/**
+	 * Registers a built-in node. The nodes are kept sorted by the name they were declared with, and their IDs are their place in that order.
+	 * That way IDs (which get saved in project files) don't depend on the order the linker happened to put the registrars in.
+	 */
+	NodeRegistrar(const string& Name, const shared_ptr<Node>& NodeType);
 };
 
-#define DECLARE_NODE(NodeClass, ...) NodeRegistrar NodeClass ## Def (make_shared<NodeClass>(__VA_ARGS__))
-#define DECLARE_NODE_CUSTOMNAME(Name, NodeClass, ...) NodeRegistrar Name (make_shared<NodeClass>(__VA_ARGS__))
\ No newline at end of file
+#define DECLARE_NODE(NodeClass, ...) NodeRegistrar NodeClass ## Def (#NodeClass, make_shared<NodeClass>(__VA_ARGS__))
+#define DECLARE_NODE_CUSTOMNAME(Name, NodeClass, ...) NodeRegistrar Name (#Name, make_shared<NodeClass>(__VA_ARGS__))
\ No newline at end of file
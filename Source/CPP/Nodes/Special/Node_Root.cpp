@@ -1,21 +1,28 @@
 // Copyright Chris Sixsmith 2020.
 
 #include "Node_Root.h"
+#include "Module/Function.h"
+#include "Compiler/EmitContext.h"
+#include "Compiler/EmitSink.h"
+#include "Compiler/GraphAnalysis.h"
+
+#if !IS_HEADLESS
 #include "Resources/Resource_Image.h"
 #include "Resources/Resource_Font.h"
-#include "Module/Function.h"
 #include "Alchemist.h"
+#endif
 
 Node_Root::Node_Root()
 {
 	
 }
 
-shared_ptr<Node> Node_Root::Clone() const
+shared_ptr<Node> Node_Root::Clone(const shared_ptr<NodePool>& Pool) const
 {
-	return make_shared<Node_Root>(*this);
+	return MakeNode<Node_Root>(Pool, *this);
 }
 
+#if !IS_HEADLESS
 void Node_Root::Draw(const Alchemist* Instance, const Point& Position, bool IsPreview) const
 {
 	Node::Draw(Instance, Position, IsPreview);
@@ -37,8 +44,9 @@ void Node_Root::Draw(const Alchemist* Instance, const Point& Position, bool IsPr
 
 	SDL_RenderCopy(Instance->GetRenderer(), ArobaseResource->GetTexture(), NULL, &Rect);
 }
+#endif
 
-bool Node_Root::EmitInternal(string& Output, vector<CompilationProblem>& Problems, vector<shared_ptr<Node>> Path)
+bool Node_Root::EmitInternal(EmitSink& Output, EmitContext& Context)
 {
 	// Root nodes emit a full function definition minus the terminating character (. or ;) which is handled by the function emit function.
 	// First we emit the function header. This includes:
@@ -46,6 +54,9 @@ bool Node_Root::EmitInternal(string& Output, vector<CompilationProblem>& Problem
 	// - The guard expression.
 
 	bool Success = true;
+
+	// Bindings from other clauses are out of scope here.
+	Context.BeginClause();
 	
 	// First emit function name
 	Output += GetFunction()->GetName();
@@ -56,17 +67,17 @@ bool Node_Root::EmitInternal(string& Output, vector<CompilationProblem>& Problem
 	for (int i = 0; i < GetFunction()->GetArity(); i++)
 	{
 		// Try to find arg-representing node
-		shared_ptr<Node> ArgPatternArg = GetConnector(i + 2);
+		Node* ArgPatternArg = GetConnector(i + 2);
 
 		if(!ArgPatternArg)
 		{
-			Problems.push_back(CompilationProblem{ shared_from_this(), "Argument " + to_string(i) + " was not defined." });
+			Context.Problems.push_back(CompilationProblem{ shared_from_this(), "Argument " + to_string(i) + " was not defined." });
 			Success = false;
 		}
 		else
 		{
 			// Emit it
-			if(!ArgPatternArg->Emit(Output, Problems, Path))
+			if(!ArgPatternArg->Emit(Output, Context))
 			{
 				Success = false;
 			}
@@ -83,11 +94,11 @@ bool Node_Root::EmitInternal(string& Output, vector<CompilationProblem>& Problem
 
 	// Now emit the guard sequence.
 	// The guard sequence is allowed to be unconnected.
-	if(shared_ptr<Node> Guard = GetConnector(1))
+	if(Node* Guard = GetConnector(1))
 	{
 		Output += "when ";
 		
-		if(!Guard->Emit(Output, Problems, Path))
+		if(!Guard->Emit(Output, Context))
 		{
 			Success = false;
 		}
@@ -98,16 +109,43 @@ bool Node_Root::EmitInternal(string& Output, vector<CompilationProblem>& Problem
 	Output += "->\n\t";
 
 	// Output the nested expression.
-	if (shared_ptr<Node> Expression = GetConnector(0))
+	if (Node* Expression = GetConnector(0))
 	{
-		if(!Expression->Emit(Output, Problems, Path))
+		// Anything the expression uses more than once is bound to a variable first, then referenced.
+		// Emitting it at every use instead would make the output grow exponentially on diamond-shaped graphs.
+		for (Node* Shared : FindSharedSubexpressions(Expression))
+		{
+			// Constants are emitted as their value wherever they're used, so don't need a variable.
+			ConstantValue Value;
+
+			if (Shared->Evaluate(Context, Value))
+			{
+				continue;
+			}
+
+			string Variable = Context.CreateVariableName();
+
+			Output += Variable;
+			Output += " = ";
+			bool Pass = Shared->Emit(Output, Context);
+			Output += ",\n\t";
+
+			Context.Bindings[Shared] = EmitBinding{ Variable, Pass };
+
+			if (!Pass)
+			{
+				Success = false;
+			}
+		}
+
+		if(!Expression->Emit(Output, Context))
 		{
 			Success = false;
 		}
 	}
 	else
 	{
-		Problems.push_back(CompilationProblem{ shared_from_this(), "Return value was not defined." });
+		Context.Problems.push_back(CompilationProblem{ shared_from_this(), "Return value was not defined." });
 		Success = false;
 	}
 
@@ -117,7 +155,7 @@ bool Node_Root::EmitInternal(string& Output, vector<CompilationProblem>& Problem
 void Node_Root::OnFunctionChanged()
 {
 	// Store connectors
-	vector<shared_ptr<Node>> Connectors;
+	vector<Node*> Connectors;
 	
 	for(int i = 0; i < GetNumArguments(); i++)
 	{
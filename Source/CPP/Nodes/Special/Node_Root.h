@@ -19,10 +19,12 @@ public:
 	// Node interface.
 	virtual string GetDisplayName() const override { return "Root"; }
 	virtual string GetCategory() const override { return "Basic"; }
-	virtual shared_ptr<Node> Clone() const override;
-	virtual void Draw(const Alchemist* Instance, const Point& Position, bool IsPreview = false) const override;
-	virtual bool EmitInternal(string& Output, vector<CompilationProblem>& Problems, vector<shared_ptr<Node>> Path) override;
+	virtual shared_ptr<Node> Clone(const shared_ptr<NodePool>& Pool = nullptr) const override;
+	virtual bool EmitInternal(EmitSink& Output, EmitContext& Context) override;
 	virtual bool CanBeOperand() const override { return false; }
+#if !IS_HEADLESS
+	virtual void Draw(const Alchemist* Instance, const Point& Position, bool IsPreview = false) const override;
+#endif
 	// End of Node interface.
 
 protected:
@@ -1,15 +1,23 @@
 // Copyright Chris Sixsmith 2020.
 
 #include "Node_Term.h"
+#include "Compiler/EmitContext.h"
+#include "Compiler/EmitSink.h"
+#include "Compiler/ConstantValue.h"
+#include "Serialiser.h"
+
+#if !IS_HEADLESS
 #include "Resources/Resource_Font.h"
 #include "Alchemist.h"
 #include "Resources/Resource_Image.h"
+#endif
 
-shared_ptr<Node> Node_Term_Int::Clone() const
+shared_ptr<Node> Node_Term_Int::Clone(const shared_ptr<NodePool>& Pool) const
 {
-	return make_shared<Node_Term_Int>(*this);
+	return MakeNode<Node_Term_Int>(Pool, *this);
 }
 
+#if !IS_HEADLESS
 void Node_Term_Int::Draw(const Alchemist* Instance, const Point& Position, bool IsPreview) const
 {
 	shared_ptr<Resource_Image> NodeResource = Instance->GetResourceManager()->GetResource<Resource_Image>("Node.png");
@@ -28,50 +36,48 @@ void Node_Term_Int::Draw(const Alchemist* Instance, const Point& Position, bool
 	
 	shared_ptr<Resource_Font> Font = Instance->GetResourceManager()->GetResource<Resource_Font>("Font.ttf");
 	
-	SDL_Texture* Tex = Font->GetStringTexture(ValueText, ValueTextSize);
 	Size Siz = Font->GetStringScreenSize(ValueText, ValueTextSize);
 
-	SDL_SetTextureColorMod(Tex, 0, 0, 0);
-	
-	SDL_Rect TexDestRect
-	{
-		Position.X + 32 - (Siz.X / 2),
-		Position.Y + 32 - (Siz.Y / 2),
-		Siz.X,
-		Siz.Y
-	};
-
-	SDL_RenderCopy(Instance->GetRenderer(), Tex, NULL, &TexDestRect);
+	Font->DrawString(ValueText, Point(Position.X + 32 - (Siz.X / 2), Position.Y + 32 - (Siz.Y / 2)), ValueTextSize);
 }
+#endif
 
-void Node_Term_Int::Load(const ifstream& FileStream)
+void Node_Term_Int::Load(istream& Stream)
 {
-	// TODO
+	SetValue(Serialiser::ReadInt32(Stream));
 }
 
-void Node_Term_Int::Save(const ofstream& FileStream) const
+void Node_Term_Int::Save(ostream& Stream) const
 {
-	// TODO
+	Serialiser::WriteInt32(Stream, Value);
 }
 
 size_t Node_Term_Int::GetDataSize() const
 {
-	return sizeof(int);
+	return sizeof(int32_t);
 }
 
-bool Node_Term_Int::EmitInternal(string& Output, vector<CompilationProblem>& Problems, vector<shared_ptr<Node>> Path)
+bool Node_Term_Int::EmitInternal(EmitSink& Output, EmitContext& Context)
 {
 	Output += to_string(Value);
 
 	return true;
 }
 
+bool Node_Term_Int::EvaluateInternal(EmitContext& Context, ConstantValue& Out)
+{
+	Out = ConstantValue::MakeInteger(Value);
+
+	return true;
+}
+
+#if !IS_HEADLESS
 void Node_Term_Int::HandleTextInput(const SDL_Event& Event)
 {
 	string ValueStr = to_string(Value);
 	ValueStr += Event.text.text;
 
-	Value = atoi(ValueStr.c_str());
+	SetValue(atoi(ValueStr.c_str()));
 }
 
 void Node_Term_Int::HandleKeyPress(const SDL_Event& Event)
@@ -81,16 +87,18 @@ void Node_Term_Int::HandleKeyPress(const SDL_Event& Event)
 		string ValueStr = to_string(Value);
 		ValueStr = ValueStr.substr(0, ValueStr.size() - 1);
 
-		Value = atoi(ValueStr.c_str());
+		SetValue(atoi(ValueStr.c_str()));
 	}
 }
+#endif
 
 
-shared_ptr<Node> Node_Term_Bool::Clone() const
+shared_ptr<Node> Node_Term_Bool::Clone(const shared_ptr<NodePool>& Pool) const
 {
-	return make_shared<Node_Term_Bool>(*this);
+	return MakeNode<Node_Term_Bool>(Pool, *this);
 }
 
+#if !IS_HEADLESS
 void Node_Term_Bool::Draw(const Alchemist* Instance, const Point& Position, bool IsPreview) const
 {
 	shared_ptr<Resource_Image> NodeResource = Instance->GetResourceManager()->GetResource<Resource_Image>("Node.png");
@@ -108,56 +116,55 @@ void Node_Term_Bool::Draw(const Alchemist* Instance, const Point& Position, bool
 
 	shared_ptr<Resource_Font> Font = Instance->GetResourceManager()->GetResource<Resource_Font>("Font.ttf");
 
-	SDL_Texture* Tex = Font->GetStringTexture(ValueText, 16);
 	Size Siz = Font->GetStringScreenSize(ValueText, 16);
 
-	SDL_SetTextureColorMod(Tex, 0, 0, 0);
-
-	SDL_Rect TexDestRect
-	{
-		Position.X + 32 - (Siz.X / 2),
-		Position.Y + 32 - (Siz.Y / 2),
-		Siz.X,
-		Siz.Y
-	};
-
-	SDL_RenderCopy(Instance->GetRenderer(), Tex, NULL, &TexDestRect);
+	Font->DrawString(ValueText, Point(Position.X + 32 - (Siz.X / 2), Position.Y + 32 - (Siz.Y / 2)), 16);
 }
+#endif
 
-void Node_Term_Bool::Load(const ifstream& FileStream)
+void Node_Term_Bool::Load(istream& Stream)
 {
-	// ...
+	SetValue(Serialiser::ReadUInt8(Stream) != 0);
 }
 
-void Node_Term_Bool::Save(const ofstream& FileStream) const
+void Node_Term_Bool::Save(ostream& Stream) const
 {
-	// ...
+	Serialiser::WriteUInt8(Stream, Value ? 1 : 0);
 }
 
 size_t Node_Term_Bool::GetDataSize() const
 {
-	return sizeof(bool);
+	return sizeof(uint8_t);
 }
 
-bool Node_Term_Bool::EmitInternal(string& Output, vector<CompilationProblem>& Problems, vector<shared_ptr<Node>> Path)
+bool Node_Term_Bool::EmitInternal(EmitSink& Output, EmitContext& Context)
 {
 	Output += Value ? "true" : "false";
 
 	return true;
 }
 
+bool Node_Term_Bool::EvaluateInternal(EmitContext& Context, ConstantValue& Out)
+{
+	Out = ConstantValue::MakeBoolean(Value);
+
+	return true;
+}
+
+#if !IS_HEADLESS
 void Node_Term_Bool::HandleTextInput(const SDL_Event& Event)
 {
-	Value = true;
+	SetValue(true);
 }
 
 void Node_Term_Bool::HandleKeyPress(const SDL_Event& Event)
 {
 	if (Event.key.keysym.sym == SDLK_BACKSPACE)
 	{
-		Value = false;
+		SetValue(false);
 	}
 }
+#endif
 
 
 DECLARE_NODE(Node_Term_Bool);
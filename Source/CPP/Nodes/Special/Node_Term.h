@@ -12,19 +12,22 @@ class Node_Term_Int : public Node
 {
 public:
 	// Node interface.
-	virtual shared_ptr<Node> Clone() const override;
+	virtual shared_ptr<Node> Clone(const shared_ptr<NodePool>& Pool = nullptr) const override;
 	virtual string GetDisplayName() const override { return "Integer (" + to_string(Value) + ")"; }
 	virtual string GetCategory() const override { return "Basic"; }
-	virtual void Draw(const Alchemist* Instance, const Point& Position, bool IsPreview = false) const override;
-	virtual void Load(const ifstream& FileStream) override;
-	virtual void Save(const ofstream& FileStream) const override;
+	virtual void Load(istream& Stream) override;
+	virtual void Save(ostream& Stream) const override;
 	virtual size_t GetDataSize() const override;
-	virtual bool EmitInternal(string& Output, vector<CompilationProblem>& Problems, vector<shared_ptr<Node>> Path) override;
+	virtual bool EmitInternal(EmitSink& Output, EmitContext& Context) override;
+	virtual bool EvaluateInternal(EmitContext& Context, ConstantValue& Out) override;
+#if !IS_HEADLESS
+	virtual void Draw(const Alchemist* Instance, const Point& Position, bool IsPreview = false) const override;
 	virtual void HandleTextInput(const SDL_Event& Event) override;
 	virtual void HandleKeyPress(const SDL_Event& Event) override;
+#endif
 	// End of Node interface.
 
-	void SetValue(int NewValue) { Value = NewValue; }
+	void SetValue(int NewValue) { Value = NewValue; MarkFunctionDirty(); }
 	int GetValue() { return Value; }
 
 protected:
@@ -39,19 +42,22 @@ class Node_Term_Bool : public Node
 {
 public:
 	// Node interface.
-	virtual shared_ptr<Node> Clone() const override;
+	virtual shared_ptr<Node> Clone(const shared_ptr<NodePool>& Pool = nullptr) const override;
 	virtual string GetDisplayName() const override { return "Boolean (" + string(Value ? "true" : "false") + ")"; }
 	virtual string GetCategory() const override { return "Basic"; }
-	virtual void Draw(const Alchemist* Instance, const Point& Position, bool IsPreview = false) const override;
-	virtual void Load(const ifstream& FileStream) override;
-	virtual void Save(const ofstream& FileStream) const override;
+	virtual void Load(istream& Stream) override;
+	virtual void Save(ostream& Stream) const override;
 	virtual size_t GetDataSize() const override;
-	virtual bool EmitInternal(string& Output, vector<CompilationProblem>& Problems, vector<shared_ptr<Node>> Path) override;
+	virtual bool EmitInternal(EmitSink& Output, EmitContext& Context) override;
+	virtual bool EvaluateInternal(EmitContext& Context, ConstantValue& Out) override;
+#if !IS_HEADLESS
+	virtual void Draw(const Alchemist* Instance, const Point& Position, bool IsPreview = false) const override;
 	virtual void HandleTextInput(const SDL_Event& Event) override;
 	virtual void HandleKeyPress(const SDL_Event& Event) override;
+#endif
 	// End of Node interface.
 
-	void SetValue(bool NewValue) { Value = NewValue; }
+	void SetValue(bool NewValue) { Value = NewValue; MarkFunctionDirty(); }
 	bool GetValue() { return Value; }
 
 protected:
@@ -2,6 +2,14 @@
 
 #include "Node_UserDefined.h"
 #include "Module/Function.h"
+#include "Module/Module.h"
+#include "Compiler/EmitContext.h"
+#include "Compiler/EmitSink.h"
+
+#if !IS_HEADLESS
+#include "Alchemist.h"
+#include "Resources/Resource_Font.h"
+#endif
 
 Node_UserDefined::Node_UserDefined(shared_ptr<Function> FuncIn)
 	: Func(FuncIn)
@@ -19,11 +27,12 @@ string Node_UserDefined::GetDisplayName() const
 	return Func.lock()->GetName();
 }
 
-shared_ptr<Node> Node_UserDefined::Clone() const
+shared_ptr<Node> Node_UserDefined::Clone(const shared_ptr<NodePool>& Pool) const
 {
-	return make_shared<Node_UserDefined>(*this);
+	return MakeNode<Node_UserDefined>(Pool, *this);
 }
 
+#if !IS_HEADLESS
 void Node_UserDefined::Draw(const Alchemist* Instance, const Point& Position, bool IsPreview) const
 {
 	Node::Draw(Instance, Position, IsPreview);
@@ -36,44 +45,36 @@ void Node_UserDefined::Draw(const Alchemist* Instance, const Point& Position, bo
 		shared_ptr<Resource_Font> Font = Instance->GetResourceManager()->GetResource<Resource_Font>("Font.ttf");
 
 		Size LSize = Font->GetStringScreenSize(Letter);
-		SDL_Texture* LTexture = Font->GetStringTexture(Letter);
-
-		SDL_SetTextureColorMod(LTexture, 0, 0, 0);
-
-		SDL_Rect LRect = {
-			Position.X + (GridSize / 2) - (LSize.X / 2),
-			Position.Y + (GridSize / 2) - (LSize.Y / 2),
-			LSize.X,
-			LSize.Y
-		};
 
-		SDL_RenderCopy(Instance->GetRenderer(), LTexture, NULL, &LRect);
+		Font->DrawString(Letter, Point(Position.X + (GridSize / 2) - (LSize.X / 2), Position.Y + (GridSize / 2) - (LSize.Y / 2)));
 	}
 }
+#endif
 
-bool Node_UserDefined::EmitInternal(string& Output, vector<CompilationProblem>& Problems, vector<shared_ptr<Node>> Path)
+bool Node_UserDefined::EmitInternal(EmitSink& Output, EmitContext& Context)
 {
 	if(Func.expired())
 	{
-		Problems.push_back(CompilationProblem{ shared_from_this(), "Referenced function was deleted!" });
+		Context.Problems.push_back(CompilationProblem{ shared_from_this(), "Referenced function was deleted!" });
 		return false;
 	}
 
-	Output += Func.lock()->GetName() + "(";
+	Output += Func.lock()->GetName();
+	Output += "(";
 
 	bool Success = true;
 	
 	for (int i = 0; i < Func.lock()->GetArity(); i++)
 	{
-		shared_ptr<Node> Connector = GetConnector(i);
+		Node* Connector = GetConnector(i);
 
 		if(Connector)
 		{
-			Connector->Emit(Output, Problems, Path);
+			Connector->Emit(Output, Context);
 		}
 		else
 		{
-			Problems.push_back(CompilationProblem{ shared_from_this(), "Required argument " + to_string(i+1) + " missing." });
+			Context.Problems.push_back(CompilationProblem{ shared_from_this(), "Required argument " + to_string(i+1) + " missing." });
 			Success = false;
 		}
 
@@ -104,10 +105,19 @@ void Node_UserDefined::OnModuleChanged()
 	}
 }
 
+void Node_UserDefined::OnCopiedToModule(const Module& NewModule)
+{
+	// Call the new module's version of our function.
+	if (!Func.expired())
+	{
+		Func = NewModule.GetFunction(Func.lock()->GetName());
+	}
+}
+
 void Node_UserDefined::SetupArgs()
 {
 	// Store connectors
-	vector<shared_ptr<Node>> Connectors;
+	vector<Node*> Connectors;
 
 	for (int i = 0; i < GetNumArguments(); i++)
 	{
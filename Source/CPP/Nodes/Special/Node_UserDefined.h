@@ -20,18 +20,26 @@ public:
 	// Node interface.
 	virtual string GetDisplayName() const override;
 	virtual string GetCategory() const override { return "Your Program"; }
-	virtual shared_ptr<Node> Clone() const override;
+	virtual shared_ptr<Node> Clone(const shared_ptr<NodePool>& Pool = nullptr) const override;
+	virtual bool EmitInternal(EmitSink& Output, EmitContext& Context) override;
+#if !IS_HEADLESS
 	virtual void Draw(const Alchemist* Instance, const Point& Position, bool IsPreview = false) const override;
-	virtual bool EmitInternal(string& Output, vector<CompilationProblem>& Problems, vector<shared_ptr<Node>> Path) override;
+#endif
 	// End of Node interface.
 
+	/** Returns the function this node calls, or null if it was deleted. */
+	shared_ptr<Function> GetCalledFunction() const { return Func.lock(); }
+
 protected:
 	// Node interface.
-	virtual void OnModuleChanged() override; // need to respond to the function being deleted
+	virtual void OnModuleChanged() override; // need to respond to the function's arity changing
+	virtual void OnCopiedToModule(const Module& NewModule) override;
 	// End of Node interface.
 
 	virtual void SetupArgs();
 
 private:
 	weak_ptr<Function> Func;
+
+	friend class Module;
 };
@@ -1,15 +1,22 @@
 // Copyright Chris Sixsmith 2020.
 
 #include "Node_Variable.h"
+#include "Compiler/EmitContext.h"
+#include "Compiler/EmitSink.h"
+#include "Serialiser.h"
+
+#if !IS_HEADLESS
 #include "Resources/Resource_Font.h"
 #include "Alchemist.h"
 #include "Resources/Resource_Image.h"
+#endif
 
-shared_ptr<Node> Node_Variable::Clone() const
+shared_ptr<Node> Node_Variable::Clone(const shared_ptr<NodePool>& Pool) const
 {
-	return make_shared<Node_Variable>(*this);
+	return MakeNode<Node_Variable>(Pool, *this);
 }
 
+#if !IS_HEADLESS
 void Node_Variable::Draw(const Alchemist* Instance, const Point& Position, bool IsPreview) const
 {
 	shared_ptr<Resource_Image> NodeResource = Instance->GetResourceManager()->GetResource<Resource_Image>("Node.png");
@@ -27,34 +34,39 @@ void Node_Variable::Draw(const Alchemist* Instance, const Point& Position, bool
 	{
 		int ValueTextSize = max(8, 30 - (6 * (max((int)Name.size() - 2, 0))));
 		
-		SDL_Texture* Tex = Font->GetStringTexture(Name, ValueTextSize);
 		Size Siz = Font->GetStringScreenSize(Name, ValueTextSize);
 
-		SDL_SetTextureColorMod(Tex, 0, 0, 0);
+		Font->DrawString(Name, Point(Position.X + 32 - (Siz.X / 2), Position.Y + 32 - (Siz.Y / 2)), ValueTextSize);
+	}
+}
+#endif
+
+void Node_Variable::Load(istream& Stream)
+{
+	SetName(Serialiser::ReadString(Stream));
+}
 
-		SDL_Rect TexDestRect
-		{
-			Position.X + 32 - (Siz.X / 2),
-			Position.Y + 32 - (Siz.Y / 2),
-			Siz.X,
-			Siz.Y
-		};
+void Node_Variable::Save(ostream& Stream) const
+{
+	Serialiser::WriteString(Stream, Name);
+}
 
-		SDL_RenderCopy(Instance->GetRenderer(), Tex, NULL, &TexDestRect);
-	}
+size_t Node_Variable::GetDataSize() const
+{
+	return Serialiser::GetStringSize(Name);
 }
 
-bool Node_Variable::EmitInternal(string& Output, vector<CompilationProblem>& Problems, vector<shared_ptr<Node>> Path)
+bool Node_Variable::EmitInternal(EmitSink& Output, EmitContext& Context)
 {
 	if(Name.size() == 0)
 	{
-		Problems.push_back(CompilationProblem{ shared_from_this(), "No variable name was provided." });
+		Context.Problems.push_back(CompilationProblem{ shared_from_this(), "No variable name was provided." });
 		return false;
 	}
 
 	if(!isupper(Name[0]))
 	{
-		Problems.push_back(CompilationProblem{ shared_from_this(), "Variable names must start with a capital letter to be valid Erlang." });
+		Context.Problems.push_back(CompilationProblem{ shared_from_this(), "Variable names must start with a capital letter to be valid Erlang." });
 		return false;
 	}
 	
@@ -63,17 +75,19 @@ bool Node_Variable::EmitInternal(string& Output, vector<CompilationProblem>& Pro
 	return true;
 }
 
+#if !IS_HEADLESS
 void Node_Variable::HandleTextInput(const SDL_Event& Event)
 {
-	Name += Event.text.text;
+	SetName(Name + Event.text.text);
 }
 
 void Node_Variable::HandleKeyPress(const SDL_Event& Event)
 {
 	if(Event.key.keysym.sym == SDLK_BACKSPACE)
 	{
-		Name = Name.substr(0, Name.size() - 1);
+		SetName(Name.substr(0, Name.size() - 1));
 	}
 }
+#endif
 
 DECLARE_NODE(Node_Variable);
@@ -12,19 +12,21 @@ class Node_Variable : public Node
 {
 public:
 	// Node interface.
-	virtual shared_ptr<Node> Clone() const override;
+	virtual shared_ptr<Node> Clone(const shared_ptr<NodePool>& Pool = nullptr) const override;
 	virtual string GetDisplayName() const override { return "Variable (" + Name + ")"; }
 	virtual string GetCategory() const override { return "Basic"; }
+	virtual void Load(istream& Stream) override;
+	virtual void Save(ostream& Stream) const override;
+	virtual size_t GetDataSize() const override;
+	virtual bool EmitInternal(EmitSink& Output, EmitContext& Context) override;
+#if !IS_HEADLESS
 	virtual void Draw(const Alchemist* Instance, const Point& Position, bool IsPreview = false) const override;
-	//virtual void Load(const ifstream& FileStream) override;
-	//virtual void Save(const ofstream& FileStream) const override;
-	//virtual size_t GetDataSize() const override;
-	virtual bool EmitInternal(string& Output, vector<CompilationProblem>& Problems, vector<shared_ptr<Node>> Path) override;
 	virtual void HandleTextInput(const SDL_Event& Event) override;
 	virtual void HandleKeyPress(const SDL_Event& Event) override;
+#endif
 	// End of Node interface.
 
-	void SetName(string NewValue) { Name = NewValue; }
+	void SetName(string NewValue) { Name = NewValue; MarkFunctionDirty(); }
 	string GetName() { return Name; }
 
 protected:
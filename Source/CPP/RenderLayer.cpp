@@ -0,0 +1,100 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "RenderLayer.h"
+
+RenderLayer::~RenderLayer()
+{
+	Release();
+}
+
+bool RenderLayer::Begin(SDL_Renderer* Renderer, const Size& LayerSize, const LayerKey& Key)
+{
+	if (Texture && IsDrawn && TextureSize == LayerSize && DrawnKey == Key)
+	{
+		return false;
+	}
+
+	// Until the texture is ready to draw to, the contents go straight to the screen.
+	IsDirect = true;
+	IsDrawn = false;
+
+	if (!SDL_RenderTargetSupported(Renderer))
+	{
+		return true;
+	}
+
+	if (!Texture || TextureSize != LayerSize)
+	{
+		Release();
+
+		Texture = SDL_CreateTexture(Renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, LayerSize.X, LayerSize.Y);
+
+		if (!Texture)
+		{
+			return true;
+		}
+
+		// The contents are drawn over transparent black with normal blending, which leaves premultiplied colours in the texture.
+		SDL_BlendMode Premultiplied = SDL_ComposeCustomBlendMode(
+			SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+			SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+
+		if (SDL_SetTextureBlendMode(Texture, Premultiplied) != 0)
+		{
+			Release();
+			return true;
+		}
+
+		TextureSize = LayerSize;
+	}
+
+	if (SDL_SetRenderTarget(Renderer, Texture) != 0)
+	{
+		return true;
+	}
+
+	Uint8 R, G, B, A;
+	SDL_GetRenderDrawColor(Renderer, &R, &G, &B, &A);
+
+	SDL_SetRenderDrawColor(Renderer, 0, 0, 0, 0);
+	SDL_RenderClear(Renderer);
+	SDL_SetRenderDrawColor(Renderer, R, G, B, A);
+
+	IsDirect = false;
+	DrawnKey = Key;
+
+	return true;
+}
+
+void RenderLayer::End(SDL_Renderer* Renderer)
+{
+	if (IsDirect)
+	{
+		return;
+	}
+
+	SDL_SetRenderTarget(Renderer, nullptr);
+	IsDrawn = true;
+}
+
+void RenderLayer::Draw(SDL_Renderer* Renderer, const Point& Offset) const
+{
+	if (IsDirect || !Texture)
+	{
+		return;
+	}
+
+	SDL_Rect Destination = { Offset.X, Offset.Y, TextureSize.X, TextureSize.Y };
+	SDL_RenderCopy(Renderer, Texture, NULL, &Destination);
+}
+
+void RenderLayer::Release()
+{
+	if (Texture)
+	{
+		SDL_DestroyTexture(Texture);
+		Texture = nullptr;
+	}
+
+	IsDrawn = false;
+}
@@ -0,0 +1,79 @@
+// Copyright Chris Sixsmith 2020.
+
+#pragma once
+
+#include "Libs.h"
+#include "2DPositioning.h"
+
+/** Everything a layer's contents depend on. The layer is redrawn when this changes. */
+class LayerKey
+{
+public:
+	/** Adds a value the contents depend on. */
+	LayerKey& Add(int64_t Value)
+	{
+		assert(Count < MaxValues);
+		Values[Count++] = Value;
+
+		return *this;
+	}
+
+	bool operator==(const LayerKey& Other) const
+	{
+		return Count == Other.Count && equal(Values, Values + Count, Other.Values);
+	}
+
+	bool operator!=(const LayerKey& Other) const { return !(*this == Other); }
+
+public:
+	static constexpr int MaxValues = 16;
+
+private:
+	int64_t Values[MaxValues] = {};
+	int Count = 0;
+};
+
+/**
+ * Render layer.
+ * A part of the screen that rarely changes (i.e. the toolbar), drawn into a texture once and copied to the screen every frame until what it depends on changes.
+ * - The texture is usually the size of the window, so the contents are drawn in screen coordinates like anything else.
+ *   It can be bigger and drawn at an offset instead (i.e. a pattern that scrolls with the view, which only needs drawing once).
+ * - The texture holds premultiplied alpha, so translucent contents look the same as they would drawn straight to the screen.
+ * - If the renderer can't draw to textures, the contents are drawn straight to the screen every frame instead.
+ */
+class RenderLayer
+{
+public:
+	RenderLayer() = default;
+	~RenderLayer();
+
+	// Non copyable!
+	RenderLayer(const RenderLayer&) = delete;
+	RenderLayer& operator=(const RenderLayer&) = delete;
+
+	/**
+	 * Gets ready to draw the layer's contents. Returns true if they need drawing, in which case draw them and then call End.
+	 * Returns false if the layer was last drawn for the same key and size, so the cached contents can be used as they are.
+	 */
+	bool Begin(SDL_Renderer* Renderer, const Size& LayerSize, const LayerKey& Key);
+
+	/** Returns true if the contents being drawn are going straight to the screen, so they must be drawn where they'll be seen rather than where they'd be in the texture. */
+	bool IsDrawingDirect() const { return IsDirect; }
+
+	/** Finishes drawing the layer's contents, and sends drawing back to the screen. */
+	void End(SDL_Renderer* Renderer);
+
+	/** Copies the layer to the screen, with its top left at the offset. Does nothing if its contents were drawn straight to the screen. */
+	void Draw(SDL_Renderer* Renderer, const Point& Offset = Point()) const;
+
+	/** Destroys the texture, so the next Begin redraws the contents (i.e. when the renderer has lost its textures, or is about to be destroyed). */
+	void Release();
+
+private:
+	SDL_Texture* Texture = nullptr;
+	Size TextureSize;
+
+	LayerKey DrawnKey;
+	bool IsDrawn = false;
+	bool IsDirect = false;
+};
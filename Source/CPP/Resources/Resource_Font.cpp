@@ -3,11 +3,47 @@
 #include "Resources/Resource_Font.h"
 #include "Alchemist.h"
 
+/** Reads the UTF-8 character starting at Index, and moves Index past it. Bytes that aren't valid UTF-8 come out as '?', one at a time. */
+static uint32_t NextCharacter(string_view Text, size_t& Index)
+{
+	unsigned char Lead = (unsigned char)Text[Index++];
+
+	if (Lead < 0x80)
+	{
+		return Lead;
+	}
+
+	// How many continuation bytes follow.
+	int Length = Lead >= 0xF8 ? -1 : Lead >= 0xF0 ? 3 : Lead >= 0xE0 ? 2 : Lead >= 0xC0 ? 1 : -1;
+
+	if (Length < 0)
+	{
+		return '?';
+	}
+
+	uint32_t Character = Lead & (0x3F >> Length);
+
+	for (int i = 0; i < Length; i++)
+	{
+		if (Index >= Text.size() || ((unsigned char)Text[Index] & 0xC0) != 0x80)
+		{
+			return '?';
+		}
+
+		Character = (Character << 6) | ((unsigned char)Text[Index++] & 0x3F);
+	}
+
+	return Character;
+}
+
 Resource_Font::~Resource_Font()
 {
-	for(int i = 0; i < RenderedStringTextures.size(); i++)
+	for (const auto& Atlas : Atlases)
 	{
-		SDL_DestroyTexture(RenderedStringTextures[i]);
+		for (SDL_Texture* Page : Atlas.second.Pages)
+		{
+			SDL_DestroyTexture(Page);
+		}
 	}
 
 	for (int i = 0; i < CreatedFontInstances.size(); i++)
@@ -30,75 +66,296 @@ bool Resource_Font::Load(Alchemist* Instance, string FileName)
 	return true;
 }
 
-SDL_Texture* Resource_Font::GetStringTexture(string Name, int Size)
+Size Resource_Font::GetStringScreenSize(string_view Name, int Size)
+{
+	GlyphAtlas* Atlas = GetAtlas(Size);
+
+	if (!Atlas)
+	{
+		return ::Size(0, 0);
+	}
+
+	// Lay the string out the same way DrawString does.
+	int PenX = 0;
+	int Right = 0;
+	int Height = Atlas->LineHeight;
+
+	for (size_t Index = 0; Index < Name.size();)
+	{
+		const Glyph& CharacterGlyph = GetGlyph(*Atlas, NextCharacter(Name, Index));
+
+		Right = max(Right, PenX + CharacterGlyph.OffsetX + CharacterGlyph.Source.w);
+		Height = max(Height, CharacterGlyph.Source.h);
+
+		PenX += CharacterGlyph.Advance;
+	}
+
+	return ::Size(max(Right, PenX), Height);
+}
+
+void Resource_Font::DrawString(string_view Name, const Point& Position, int Size, const SDL_Color& Color)
 {
-	auto StringTableFindAttempt = RenderedStrings.find(Size);
+	GlyphAtlas* Atlas = GetAtlas(Size);
 
-	if(StringTableFindAttempt != RenderedStrings.end())
+	if (!Atlas)
 	{
-		auto StringFindAttempt = StringTableFindAttempt->second.find(Name);
+		return;
+	}
+
+	SDL_Renderer* Renderer = AInstance->GetRenderer();
+
+	// Copies from the same page are sent to the GPU together, and ASCII text only ever uses the first.
+	int PenX = Position.X;
+	int ColoredPages = 0;
+
+	for (size_t Index = 0; Index < Name.size();)
+	{
+		const Glyph& CharacterGlyph = GetGlyph(*Atlas, NextCharacter(Name, Index));
 
-		if(StringFindAttempt != StringTableFindAttempt->second.end())
+		// Getting the glyph can add pages, so they're colored as they come up.
+		for (; ColoredPages < (int)Atlas->Pages.size(); ColoredPages++)
 		{
-			return StringFindAttempt->second;
+			SDL_SetTextureColorMod(Atlas->Pages[ColoredPages], Color.r, Color.g, Color.b);
+			SDL_SetTextureAlphaMod(Atlas->Pages[ColoredPages], Color.a);
+		}
+
+		if (CharacterGlyph.Source.w > 0)
+		{
+			SDL_Rect DestRect = {
+				PenX + CharacterGlyph.OffsetX,
+				Position.Y,
+				CharacterGlyph.Source.w,
+				CharacterGlyph.Source.h
+			};
+
+			SDL_RenderCopy(Renderer, Atlas->Pages[CharacterGlyph.Page], &CharacterGlyph.Source, &DestRect);
 		}
+
+		PenX += CharacterGlyph.Advance;
 	}
-	
-	return CreateTexture(Name, Size);
 }
 
-Size Resource_Font::GetStringScreenSize(string Name, int Size)
+Resource_Font::GlyphAtlas* Resource_Font::GetAtlas(int Size)
 {
-	auto StringTableFindAttempt = RenderedStringSizes.find(Size);
+	auto AtlasFindAttempt = Atlases.find(Size);
+
+	if (AtlasFindAttempt != Atlases.end())
+	{
+		return !AtlasFindAttempt->second.Pages.empty() ? &AtlasFindAttempt->second : nullptr;
+	}
+
+	// Only tried once for each size, whether it works or not.
+	GlyphAtlas& Atlas = Atlases[Size];
+
+	auto FontFindAttempt = Fonts.find(Size);
+	TTF_Font* Font = FontFindAttempt != Fonts.end() ? FontFindAttempt->second : LoadSize(Size);
+
+	if (!Font)
+	{
+		return nullptr;
+	}
+
+	Atlas.Font = Font;
+	Atlas.LineHeight = TTF_FontHeight(Font);
+
+	// Render each glyph on its own, and work out where it goes. Glyphs are packed into rows, with a pixel between them so they don't bleed into each other.
+	const int AtlasWidth = PageSize;
+	const int GlyphCount = LastGlyph - FirstGlyph + 1;
+
+	SDL_Surface* GlyphSurfaces[GlyphCount] = {};
+
+	int PenX = 0;
+	int PenY = 0;
+	int RowHeight = 0;
+
+	for (int i = 0; i < GlyphCount; i++)
+	{
+		char Text[2] = { (char)(FirstGlyph + i), '\0' };
+		Glyph& NewGlyph = Atlas.Glyphs[i];
+
+		int MinX = 0, MaxX = 0, MinY = 0, MaxY = 0, Advance = 0;
+		TTF_GlyphMetrics(Font, (Uint16)Text[0], &MinX, &MaxX, &MinY, &MaxY, &Advance);
+
+		// A rendered string starts at the leftmost point of its glyphs, which can be left of the pen.
+		NewGlyph.OffsetX = min(0, MinX);
+		NewGlyph.Advance = Advance;
+
+		GlyphSurfaces[i] = TTF_RenderText_Solid(Font, Text, SDL_Color{ 255, 255, 255, 255 });
+
+		if (!GlyphSurfaces[i])
+		{
+			continue; // i.e. space, which has no image
+		}
 
-	if (StringTableFindAttempt != RenderedStringSizes.end())
+		if (PenX + GlyphSurfaces[i]->w > AtlasWidth)
+		{
+			PenX = 0;
+			PenY += RowHeight + 1;
+			RowHeight = 0;
+		}
+
+		NewGlyph.Source = { PenX, PenY, GlyphSurfaces[i]->w, GlyphSurfaces[i]->h };
+
+		PenX += GlyphSurfaces[i]->w + 1;
+		RowHeight = max(RowHeight, GlyphSurfaces[i]->h);
+	}
+
+	// Then copy them all into one surface, and upload it.
+	SDL_Surface* AtlasSurface = SDL_CreateRGBSurfaceWithFormat(0, AtlasWidth, max(1, PenY + RowHeight), 32, SDL_PIXELFORMAT_RGBA32);
+
+	if (AtlasSurface)
 	{
-		auto StringFindAttempt = StringTableFindAttempt->second.find(Name);
+		SDL_FillRect(AtlasSurface, NULL, SDL_MapRGBA(AtlasSurface->format, 0, 0, 0, 0));
+	}
 
-		if (StringFindAttempt != StringTableFindAttempt->second.end())
+	for (int i = 0; i < GlyphCount; i++)
+	{
+		if (GlyphSurfaces[i])
 		{
-			return StringFindAttempt->second;
+			if (AtlasSurface)
+			{
+				SDL_Rect DestRect = Atlas.Glyphs[i].Source;
+				SDL_BlitSurface(GlyphSurfaces[i], NULL, AtlasSurface, &DestRect);
+			}
+
+			SDL_FreeSurface(GlyphSurfaces[i]);
 		}
 	}
 
-	// horrible but it works fine
-	assert(CreateTexture(Name, Size) != nullptr);
-	return GetStringScreenSize(Name, Size);
+	if (!AtlasSurface)
+	{
+		cout << "Couldn't create glyph atlas. " << SDL_GetError() << endl;
+		return nullptr;
+	}
+
+	SDL_Texture* Texture = SDL_CreateTextureFromSurface(AInstance->GetRenderer(), AtlasSurface);
+	SDL_FreeSurface(AtlasSurface);
+
+	if (!Texture)
+	{
+		return nullptr;
+	}
+
+	SDL_SetTextureBlendMode(Texture, SDL_BLENDMODE_BLEND);
+	Atlas.Pages.push_back(Texture);
+
+	return &Atlas;
 }
 
-SDL_Texture* Resource_Font::CreateTexture(string Name, int Size)
+const Resource_Font::Glyph& Resource_Font::GetGlyph(GlyphAtlas& Atlas, uint32_t Character)
 {
-	auto FontFindAttempt = Fonts.find(Size);
+	if (Character >= (uint32_t)FirstGlyph && Character <= (uint32_t)LastGlyph)
+	{
+		return Atlas.Glyphs[Character - FirstGlyph];
+	}
 
-	TTF_Font* Font = nullptr;
+	const Glyph& Unknown = Atlas.Glyphs['?' - FirstGlyph];
 
-	if(FontFindAttempt != Fonts.end())
+	// Control characters have nothing to draw, and SDL_ttf only takes characters up to 0xFFFF.
+	if (Character < 0xA0 || Character > 0xFFFF)
 	{
-		Font = FontFindAttempt->second;
+		return Unknown;
 	}
-	else
+
+	auto GlyphFindAttempt = Atlas.OtherGlyphs.find((Uint16)Character);
+
+	if (GlyphFindAttempt != Atlas.OtherGlyphs.end())
 	{
-		Font = LoadSize(Size);
+		return GlyphFindAttempt->second;
 	}
 
-	if(!Font)
+	// Only tried once for each character, whether it works or not.
+	Glyph& NewGlyph = Atlas.OtherGlyphs[(Uint16)Character];
+	NewGlyph = Unknown;
+
+	if (!TTF_GlyphIsProvided(Atlas.Font, (Uint16)Character))
 	{
-		return nullptr;
+		return NewGlyph;
 	}
-	
-	// Create a new texture
-	SDL_Surface* TextureSurface = TTF_RenderText_Solid(Font, Name.c_str(), SDL_Color{ 255, 255, 255, 255 });
 
-	SDL_Texture* Texture = SDL_CreateTextureFromSurface(AInstance->GetRenderer(), TextureSurface);
+	int MinX = 0, MaxX = 0, MinY = 0, MaxY = 0, Advance = 0;
+	TTF_GlyphMetrics(Atlas.Font, (Uint16)Character, &MinX, &MaxX, &MinY, &MaxY, &Advance);
 
-	RenderedStringTextures.push_back(Texture);
-	
-	RenderedStrings[Size][Name] = Texture;
-	RenderedStringSizes[Size][Name] = ::Size(TextureSurface->w, TextureSurface->h);
+	SDL_Surface* GlyphSurface = TTF_RenderGlyph_Solid(Atlas.Font, (Uint16)Character, SDL_Color{ 255, 255, 255, 255 });
+
+	if (!GlyphSurface)
+	{
+		// i.e. a no-break space, which has no image
+		NewGlyph = Glyph();
+		NewGlyph.Advance = Advance;
+
+		return NewGlyph;
+	}
 
-	SDL_FreeSurface(TextureSurface);
+	Glyph Added;
+	Added.OffsetX = min(0, MinX);
+	Added.Advance = Advance;
 
-	return Texture;
+	if (AddToPage(Atlas, GlyphSurface, Added))
+	{
+		NewGlyph = Added;
+	}
+
+	SDL_FreeSurface(GlyphSurface);
+
+	return NewGlyph;
+}
+
+bool Resource_Font::AddToPage(GlyphAtlas& Atlas, SDL_Surface* GlyphSurface, Glyph& NewGlyph)
+{
+	if (GlyphSurface->w > PageSize || GlyphSurface->h > PageSize)
+	{
+		return false;
+	}
+
+	if (Atlas.PenX + GlyphSurface->w > PageSize)
+	{
+		Atlas.PenX = 0;
+		Atlas.PenY += Atlas.RowHeight + 1;
+		Atlas.RowHeight = 0;
+	}
+
+	// The ASCII page is packed tight, so the first other glyph always starts a page of its own.
+	if (Atlas.Pages.size() == 1 || Atlas.PenY + GlyphSurface->h > PageSize)
+	{
+		SDL_Texture* Page = SDL_CreateTexture(AInstance->GetRenderer(), SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, PageSize, PageSize);
+
+		if (!Page)
+		{
+			return false;
+		}
+
+		vector<Uint32> Clear(PageSize * PageSize, 0);
+		SDL_UpdateTexture(Page, NULL, Clear.data(), PageSize * sizeof(Uint32));
+		SDL_SetTextureBlendMode(Page, SDL_BLENDMODE_BLEND);
+
+		Atlas.Pages.push_back(Page);
+		Atlas.PenX = 0;
+		Atlas.PenY = 0;
+		Atlas.RowHeight = 0;
+	}
+
+	// Glyphs come out paletted, so they go through a surface in the page's format on the way up.
+	SDL_Surface* Converted = SDL_CreateRGBSurfaceWithFormat(0, GlyphSurface->w, GlyphSurface->h, 32, SDL_PIXELFORMAT_RGBA32);
+
+	if (!Converted)
+	{
+		return false;
+	}
+
+	SDL_FillRect(Converted, NULL, SDL_MapRGBA(Converted->format, 0, 0, 0, 0));
+	SDL_BlitSurface(GlyphSurface, NULL, Converted, NULL);
+
+	NewGlyph.Source = { Atlas.PenX, Atlas.PenY, GlyphSurface->w, GlyphSurface->h };
+	NewGlyph.Page = (int)Atlas.Pages.size() - 1;
+
+	SDL_UpdateTexture(Atlas.Pages.back(), &NewGlyph.Source, Converted->pixels, Converted->pitch);
+	SDL_FreeSurface(Converted);
+
+	Atlas.PenX += GlyphSurface->w + 1;
+	Atlas.RowHeight = max(Atlas.RowHeight, GlyphSurface->h);
+
+	return true;
 }
 
 TTF_Font* Resource_Font::LoadSize(int Size)
@@ -107,9 +364,6 @@ TTF_Font* Resource_Font::LoadSize(int Size)
 
 	Fonts[Size] = FontInstance;
 	CreatedFontInstances.push_back(FontInstance);
-
-	RenderedStrings[Size] = unordered_map<string, SDL_Texture*>();
-	RenderedStringSizes[Size] = unordered_map<string, ::Size>();
 	
 	return FontInstance;
 }
@@ -5,9 +5,14 @@
 #include "2DPositioning.h"
 #include "Resources.h"
 
-// TODO generation of font textures, font texture cache
-
-/** Font Resource class. */
+/**
+ * Font Resource class.
+ * Text is drawn from glyph atlases: the first time a size is used, every printable ASCII glyph is rendered once into one texture for that size.
+ * Strings are then laid out from the glyphs' cached metrics, and drawn as one copy per glyph from the same texture (which SDL batches together), so new strings don't create anything.
+ * That keeps memory flat: there is one texture per size, however many different strings are drawn.
+ * - Strings are UTF-8. Any other character is rasterised into the size's atlas the first time it's drawn, on extra pages after the ASCII one.
+ * - SDL_ttf only renders the basic multilingual plane, so characters beyond it, characters the font doesn't have, control characters and bad UTF-8 are drawn as '?'.
+ */
 class Resource_Font : public Resource
 {
 public:
@@ -17,25 +22,63 @@ public:
 	/** Handles loading the resource files. */
 	virtual bool Load(Alchemist* Instance, string FileName) override;
 
-	/** Returns the texture for the given string. */
-	SDL_Texture* GetStringTexture(string Name, int Size = 30);
+	/** Returns the screen size for the given string, as drawn by DrawString. Worked out from the glyph metrics, so nothing is rendered. */
+	Size GetStringScreenSize(string_view Name, int Size = 30);
 
-	/** Returns the screen size for the given string. */
-	Size GetStringScreenSize(string Name, int Size = 30);
+	/** Draws a string with its top left corner at the given position. */
+	void DrawString(string_view Name, const Point& Position, int Size = 30, const SDL_Color& Color = SDL_Color{ 0, 0, 0, 255 });
 
 private:
-	SDL_Texture* CreateTexture(string Name, int Size = 30);
+	/** Where a glyph is in its atlas, and how to place it. */
+	struct Glyph
+	{
+		SDL_Rect Source = { 0, 0, 0, 0 };
+		int OffsetX = 0; // from the pen position to the left edge of the glyph's image
+		int Advance = 0; // how far the pen moves on afterwards
+		int Page = 0; // which of the atlas's textures it's in
+	};
+
+	static constexpr char FirstGlyph = ' ';
+	static constexpr char LastGlyph = '~';
+
+	/** Every glyph of one size drawn so far. */
+	struct GlyphAtlas
+	{
+		TTF_Font* Font = nullptr;
+		int LineHeight = 0;
+
+		// Page 0 holds every printable ASCII glyph, packed when the atlas is made. Other glyphs go on later pages as they're needed.
+		vector<SDL_Texture*> Pages;
+
+		Glyph Glyphs[LastGlyph - FirstGlyph + 1];
+		unordered_map<Uint16, Glyph> OtherGlyphs;
+
+		// Where the next glyph goes on the last page.
+		int PenX = 0;
+		int PenY = 0;
+		int RowHeight = 0;
+	};
+
+	static constexpr int PageSize = 512;
+
 	TTF_Font* LoadSize(int Size);
 
+	/** Returns the atlas for a size, rendering it first if this is the first time the size is used. Null if the font couldn't be loaded in that size. */
+	GlyphAtlas* GetAtlas(int Size);
+
+	/** Returns the glyph for a character, rasterising it into the atlas if it hasn't been drawn in this size before. */
+	const Glyph& GetGlyph(GlyphAtlas& Atlas, uint32_t Character);
+
+	/** Copies a rendered glyph into the atlas's last page, starting a new page if it's full. Returns false if it couldn't be added. */
+	bool AddToPage(GlyphAtlas& Atlas, SDL_Surface* GlyphSurface, Glyph& NewGlyph);
+
 private:
 	string FontFileName;
 	
 	unordered_map<int, TTF_Font*> Fonts;
 	vector<TTF_Font*> CreatedFontInstances;
 	
-	unordered_map<int, unordered_map<string, SDL_Texture*>> RenderedStrings;
-	unordered_map<int, unordered_map<string, Size>> RenderedStringSizes;
-	vector<SDL_Texture*> RenderedStringTextures;
+	unordered_map<int, GlyphAtlas> Atlases;
 
 	Alchemist* AInstance;
 };
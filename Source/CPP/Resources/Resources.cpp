@@ -47,7 +47,7 @@ void ResourceManager::LoadResources(Alchemist* Instance)
 	}
 }
 
-shared_ptr<Resource> ResourceManager::GetResource(string Name) const
+shared_ptr<Resource> ResourceManager::GetResource(const string& Name) const
 {
 	assert(Resources.find(Name) != Resources.end());
 	return Resources.find(Name)->second;
@@ -0,0 +1,444 @@
+// Copyright Chris Sixsmith 2020.
+
+#include "Serialiser.h"
+#include "Variables.h"
+#include "Module/Module.h"
+#include "Module/Function.h"
+#include "Nodes/Nodes.h"
+#include "Nodes/Special/Node_UserDefined.h"
+
+static const string FileHeader = "### This is an Alchemist project data file. DO NOT mess with it! ###";
+static const char FileMagic[4] = { 'A', 'L', 'C', 'H' };
+
+bool Serialiser::Save(const Module& SaveModule, const string& Path, string& Error)
+{
+	ofstream File(Path, ios::binary);
+
+	if (!File)
+	{
+		Error = "Couldn't open " + Path + " for writing.";
+		return false;
+	}
+
+	File << FileHeader << "\n";
+	File.write(FileMagic, sizeof(FileMagic));
+	WriteInt32(File, FormatVersion);
+
+	// Constants. There aren't any yet.
+	WriteInt32(File, 0);
+	WriteSize(File, 0);
+
+	const vector<shared_ptr<Function>>& Functions = SaveModule.GetFunctions();
+	unordered_map<const Function*, int> FunctionIndices;
+
+	for (int i = 0; i < Functions.size(); i++)
+	{
+		FunctionIndices[Functions[i].get()] = i + 1;
+	}
+
+	WriteInt32(File, (int32_t)Functions.size());
+
+	// Function headers.
+	ostringstream Headers;
+
+	for (int i = 0; i < Functions.size(); i++)
+	{
+		ostringstream Header;
+
+		WriteInt32(Header, i + 1);
+		WriteString(Header, Functions[i]->GetName());
+		WriteUInt8(Header, (uint8_t)Type::Any);
+		WriteInt32(Header, Functions[i]->GetArity());
+
+		ostringstream Arguments;
+
+		for (int Arg = 0; Arg < Functions[i]->GetArity(); Arg++)
+		{
+			WriteInt32(Arguments, Arg);
+			WriteString(Arguments, "Arg" + to_string(Arg + 1));
+			WriteUInt8(Arguments, (uint8_t)Type::Any);
+		}
+
+		WriteBlock(Header, Arguments);
+		WriteBlock(Headers, Header);
+	}
+
+	WriteBlock(File, Headers);
+
+	// Function contents.
+	ostringstream Contents;
+
+	for (const shared_ptr<Function>& SaveFunction : Functions)
+	{
+		ostringstream Content;
+
+		if (!SaveFunctionContent(Content, *SaveFunction, FunctionIndices, Error))
+		{
+			return false;
+		}
+
+		WriteBlock(Contents, Content);
+	}
+
+	WriteBlock(File, Contents);
+
+	if (!File)
+	{
+		Error = "Couldn't write to " + Path + ".";
+		return false;
+	}
+
+	return true;
+}
+
+bool Serialiser::Load(Module& LoadModule, const NodeManager& Nodes, const string& Path, string& Error)
+{
+	ifstream File(Path, ios::binary);
+
+	if (!File)
+	{
+		Error = "Couldn't open " + Path + ".";
+		return false;
+	}
+
+	string Header;
+	getline(File, Header);
+
+	char Magic[sizeof(FileMagic)] = {};
+	File.read(Magic, sizeof(Magic));
+
+	if (Header != FileHeader || memcmp(Magic, FileMagic, sizeof(FileMagic)) != 0)
+	{
+		Error = Path + " isn't an Alchemist project.";
+		return false;
+	}
+
+	int32_t Version = ReadInt32(File);
+
+	if (Version != FormatVersion)
+	{
+		Error = Path + " was saved in format version " + to_string(Version) + ", which this version of Alchemist can't read.";
+		return false;
+	}
+
+	// Constants. Nothing uses them yet, so skip over them.
+	ReadInt32(File);
+	File.ignore(ReadSize(File));
+
+	// Function headers. Every function is created before any content is loaded, so calls between them can be resolved.
+	int32_t FunctionCount = ReadInt32(File);
+	ReadSize(File);
+
+	if (!File || FunctionCount < 0)
+	{
+		Error = Path + " is damaged.";
+		return false;
+	}
+
+	LoadModule.Clear();
+
+	vector<shared_ptr<Function>> Functions;
+
+	for (int i = 0; i < FunctionCount; i++)
+	{
+		ReadSize(File);
+
+		int32_t Index = ReadInt32(File);
+		string Name = ReadString(File);
+		ReadUInt8(File); // return type
+		int32_t Arity = ReadInt32(File);
+
+		// Argument names and types aren't used yet.
+		File.ignore(ReadSize(File));
+
+		if (!File || Index != i + 1 || Arity < 0 || LoadModule.GetFunction(Name))
+		{
+			Error = Path + " is damaged (bad function header " + to_string(i + 1) + ").";
+			return false;
+		}
+
+		Functions.push_back(LoadModule.CreateOrGetFunction(Name, Arity));
+	}
+
+	// Function contents.
+	ReadSize(File);
+
+	for (const shared_ptr<Function>& LoadFunction : Functions)
+	{
+		ReadSize(File);
+
+		if (!LoadFunctionContent(File, *LoadFunction, Nodes, Error))
+		{
+			Error = Path + ": " + Error;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Serialiser::WriteUInt8(ostream& Stream, uint8_t Value)
+{
+	Stream.put((char)Value);
+}
+
+void Serialiser::WriteInt32(ostream& Stream, int32_t Value)
+{
+	uint32_t Bits = (uint32_t)Value;
+	char Bytes[4];
+
+	for (int i = 0; i < 4; i++)
+	{
+		Bytes[i] = (char)((Bits >> (i * 8)) & 0xFF);
+	}
+
+	Stream.write(Bytes, sizeof(Bytes));
+}
+
+void Serialiser::WriteSize(ostream& Stream, uint64_t Value)
+{
+	char Bytes[8];
+
+	for (int i = 0; i < 8; i++)
+	{
+		Bytes[i] = (char)((Value >> (i * 8)) & 0xFF);
+	}
+
+	Stream.write(Bytes, sizeof(Bytes));
+}
+
+void Serialiser::WriteString(ostream& Stream, const string& Value)
+{
+	WriteSize(Stream, Value.size());
+	Stream.write(Value.data(), Value.size());
+}
+
+uint8_t Serialiser::ReadUInt8(istream& Stream)
+{
+	char Byte = 0;
+	Stream.get(Byte);
+
+	return Stream ? (uint8_t)Byte : 0;
+}
+
+int32_t Serialiser::ReadInt32(istream& Stream)
+{
+	unsigned char Bytes[4] = {};
+	Stream.read((char*)Bytes, sizeof(Bytes));
+
+	if (!Stream)
+	{
+		return 0;
+	}
+
+	uint32_t Bits = 0;
+
+	for (int i = 0; i < 4; i++)
+	{
+		Bits |= (uint32_t)Bytes[i] << (i * 8);
+	}
+
+	return (int32_t)Bits;
+}
+
+uint64_t Serialiser::ReadSize(istream& Stream)
+{
+	unsigned char Bytes[8] = {};
+	Stream.read((char*)Bytes, sizeof(Bytes));
+
+	if (!Stream)
+	{
+		return 0;
+	}
+
+	uint64_t Value = 0;
+
+	for (int i = 0; i < 8; i++)
+	{
+		Value |= (uint64_t)Bytes[i] << (i * 8);
+	}
+
+	return Value;
+}
+
+string Serialiser::ReadString(istream& Stream)
+{
+	uint64_t Length = ReadSize(Stream);
+
+	if (!Stream || Length > MaxStringSize)
+	{
+		Stream.setstate(ios::failbit);
+		return "";
+	}
+
+	string Value((size_t)Length, '\0');
+	Stream.read(&Value[0], Length);
+
+	return Stream ? Value : "";
+}
+
+void Serialiser::WriteBlock(ostream& Stream, const ostringstream& Block)
+{
+	string Data = Block.str();
+
+	WriteSize(Stream, Data.size());
+	Stream.write(Data.data(), Data.size());
+}
+
+bool Serialiser::SaveFunctionContent(ostream& Stream, const Function& SaveFunction, const unordered_map<const Function*, int>& FunctionIndices, string& Error)
+{
+	vector<shared_ptr<Node>> FunctionNodes = SaveFunction.GetNodesOfClass<Node>();
+
+	// Nodes.
+	ostringstream NodeBlock;
+	int32_t NodeCount = 0;
+
+	for (const shared_ptr<Node>& SaveNode : FunctionNodes)
+	{
+		int ID = SaveNode->GetID();
+
+		// Calls are saved against the function they call now, rather than whatever ID they were given when they were created.
+		if (shared_ptr<Node_UserDefined> Call = dynamic_pointer_cast<Node_UserDefined>(SaveNode))
+		{
+			auto Found = FunctionIndices.find(Call->GetCalledFunction().get());
+
+			if (Found == FunctionIndices.end())
+			{
+				continue; // calls a deleted function, so it's about to be removed anyway
+			}
+
+			ID = -Found->second;
+		}
+		else if (ID < 0)
+		{
+			Error = "The node at (" + to_string(SaveNode->GetGridPosition().X) + ", " + to_string(SaveNode->GetGridPosition().Y) + ") in " + SaveFunction.GetName() + " wasn't created by the node manager, so can't be saved.";
+			return false;
+		}
+
+		ostringstream Packet;
+		SaveNode->Save(Packet);
+
+		assert(Packet.str().size() == SaveNode->GetDataSize());
+
+		WriteInt32(NodeBlock, ID);
+		WriteInt32(NodeBlock, SaveNode->GetGridPosition().X);
+		WriteInt32(NodeBlock, SaveNode->GetGridPosition().Y);
+		WriteBlock(NodeBlock, Packet);
+
+		NodeCount++;
+	}
+
+	WriteInt32(Stream, NodeCount);
+	WriteBlock(Stream, NodeBlock);
+
+	// Connectors. Each one is saved on the node it points into.
+	ostringstream ConnectorBlock;
+	int32_t ConnectorCount = 0;
+
+	for (const shared_ptr<Node>& Target : FunctionNodes)
+	{
+		for (int Arg = 0; Arg < Target->GetNumArguments(); Arg++)
+		{
+			Node* Start = Target->GetConnector(Arg);
+
+			if (!Start || Start->GetFunction() != &SaveFunction)
+			{
+				continue;
+			}
+
+			WriteInt32(ConnectorBlock, Start->GetGridPosition().X);
+			WriteInt32(ConnectorBlock, Start->GetGridPosition().Y);
+			WriteInt32(ConnectorBlock, Target->GetGridPosition().X);
+			WriteInt32(ConnectorBlock, Target->GetGridPosition().Y);
+			WriteUInt8(ConnectorBlock, (uint8_t)Arg);
+
+			ConnectorCount++;
+		}
+	}
+
+	WriteInt32(Stream, ConnectorCount);
+	WriteBlock(Stream, ConnectorBlock);
+
+	return true;
+}
+
+bool Serialiser::LoadFunctionContent(istream& Stream, Function& LoadFunction, const NodeManager& Nodes, string& Error)
+{
+	// Nodes.
+	int32_t NodeCount = ReadInt32(Stream);
+	ReadSize(Stream);
+
+	for (int i = 0; i < NodeCount && Stream; i++)
+	{
+		int32_t ID = ReadInt32(Stream);
+		Point Position;
+		Position.X = ReadInt32(Stream);
+		Position.Y = ReadInt32(Stream);
+
+		uint64_t PacketSize = ReadSize(Stream);
+
+		if (!Stream || PacketSize > MaxStringSize)
+		{
+			break;
+		}
+
+		string Packet((size_t)PacketSize, '\0');
+		Stream.read(&Packet[0], PacketSize);
+
+		shared_ptr<Node> LoadNode = LoadFunction.CreateNode(Nodes, ID, Position);
+
+		if (!LoadNode)
+		{
+			Error = "Couldn't create node " + to_string(ID) + " at (" + to_string(Position.X) + ", " + to_string(Position.Y) + ") in " + LoadFunction.GetName() + ".";
+			return false;
+		}
+
+		// Nodes only get to see their own packet, so one that reads too much can't throw the rest of the file off.
+		istringstream PacketStream(Packet);
+		LoadNode->Load(PacketStream);
+
+		if (!PacketStream)
+		{
+			Error = "Bad data for the node at (" + to_string(Position.X) + ", " + to_string(Position.Y) + ") in " + LoadFunction.GetName() + ".";
+			return false;
+		}
+	}
+
+	// Connectors. These go in once every node exists.
+	int32_t ConnectorCount = ReadInt32(Stream);
+	ReadSize(Stream);
+
+	for (int i = 0; i < ConnectorCount && Stream; i++)
+	{
+		Point StartPosition, TargetPosition;
+		StartPosition.X = ReadInt32(Stream);
+		StartPosition.Y = ReadInt32(Stream);
+		TargetPosition.X = ReadInt32(Stream);
+		TargetPosition.Y = ReadInt32(Stream);
+		int Arg = ReadUInt8(Stream);
+
+		if (!Stream)
+		{
+			break;
+		}
+
+		shared_ptr<Node> Start = LoadFunction.GetNodeAt(StartPosition);
+		shared_ptr<Node> Target = LoadFunction.GetNodeAt(TargetPosition);
+
+		if (!Start || !Target || Arg >= Target->GetNumArguments())
+		{
+			Error = "Bad connector " + to_string(i) + " in " + LoadFunction.GetName() + ".";
+			return false;
+		}
+
+		Target->SetConnector(Start.get(), Arg);
+	}
+
+	if (!Stream || NodeCount < 0 || ConnectorCount < 0)
+	{
+		Error = "Unexpected end of file in " + LoadFunction.GetName() + ".";
+		return false;
+	}
+
+	return true;
+}
@@ -2,6 +2,12 @@
 
 #pragma once
 
+#include "Libs.h"
+
+class Module;
+class Function;
+class NodeManager;
+
 /**
  * Serialiser class.
  * Saving and loading an Alchemist project is fairly simple.
@@ -67,9 +73,52 @@
  *   relies upon user function call nodes not needing the function being called to have any content upon being created.
  *
  * You should never have to read the ALCH file out of order. The data in one part of the file uses data from the last, and so on.
+ *
+ * All numbers are little endian. Sizes (size_t above) are always written as 64 bits, so files are the same on 32 bit builds (i.e. the web).
+ * Built-in node IDs are their place in the list of built-in nodes sorted by name, so every build that reads the file must have the same node list.
+ * Constants and argument/return types aren't implemented yet - none are written, and every type is written as Type::Any.
  */
 class Serialiser
 {
 public:
-	
+	/** The format version this build reads and writes. */
+	static constexpr int32_t FormatVersion = 1;
+
+	/** Saves a module to a file. Returns false and describes what went wrong in Error if it couldn't be saved. */
+	static bool Save(const Module& SaveModule, const string& Path, string& Error);
+
+	/**
+	 * Loads a module from a file, replacing all of its functions. Nodes are created from the given node manager, which must be for the same module.
+	 * Returns false and describes what went wrong in Error if it couldn't be loaded. The module may be partly loaded if that happens.
+	 */
+	static bool Load(Module& LoadModule, const NodeManager& Nodes, const string& Path, string& Error);
+
+	// Reading and writing the values the format is made of. Nodes use these for their data packets.
+	// Reads return 0 (or an empty string) and leave the stream failed if there wasn't enough data.
+
+	static void WriteUInt8(ostream& Stream, uint8_t Value);
+	static void WriteInt32(ostream& Stream, int32_t Value);
+	static void WriteSize(ostream& Stream, uint64_t Value);
+	static void WriteString(ostream& Stream, const string& Value);
+
+	static uint8_t ReadUInt8(istream& Stream);
+	static int32_t ReadInt32(istream& Stream);
+	static uint64_t ReadSize(istream& Stream);
+	static string ReadString(istream& Stream);
+
+	/** Returns how many bytes WriteString writes for a string. */
+	static size_t GetStringSize(const string& Value) { return sizeof(uint64_t) + Value.size(); }
+
+private:
+	/** Writes a block's size, then the block. */
+	static void WriteBlock(ostream& Stream, const ostringstream& Block);
+
+	/** Writes a function's nodes and connectors. */
+	static bool SaveFunctionContent(ostream& Stream, const Function& SaveFunction, const unordered_map<const Function*, int>& FunctionIndices, string& Error);
+
+	/** Reads a function's nodes and connectors. */
+	static bool LoadFunctionContent(istream& Stream, Function& LoadFunction, const NodeManager& Nodes, string& Error);
+
+	// Strings and data packets bigger than this are taken to mean the file is damaged.
+	static constexpr uint64_t MaxStringSize = 1 << 20;
 };
@@ -33,6 +33,23 @@ enum class Type
 };
 
 
+/**
+ * Node handle.
+ * Identifies a node within the function it's placed in. Handles stay the same for as long as the node is in the function, whatever else is added or removed.
+ * A slot is reused once its node is removed, but with a new generation, so handles to the old node stop working rather than finding the new one.
+ */
+struct NodeHandle
+{
+	uint32_t Index = 0;
+	uint32_t Generation = 0; // 0 is never a live generation, so a default handle is always invalid
+
+	bool IsValid() const { return Generation != 0; }
+
+	bool operator==(const NodeHandle& Other) const { return Index == Other.Index && Generation == Other.Generation; }
+	bool operator!=(const NodeHandle& Other) const { return !(*this == Other); }
+};
+
+
 /** Node argument data. */
 struct NodeArgumentData
 {
@@ -42,6 +59,17 @@ struct NodeArgumentData
 	/** Whether the argument expression is treated as a pattern (i.e. must be evaluatable at compile time, but is allowed to contain unassigned variables). */
 	bool IsPattern = false;
 
-	/** Node linked from. */
-	weak_ptr<Node> Connector;
+	/** Node linked from, within the same function. */
+	NodeHandle Connector;
+};
+
+
+/** An argument a node is connected to, i.e. one of the places its value is used. */
+struct NodeConsumer
+{
+	/** The node using the value. */
+	NodeHandle Consumer;
+
+	/** Which of the consumer's arguments it goes into. */
+	int Argument = 0;
 };
@@ -0,0 +1,226 @@
+// Copyright Chris Sixsmith 2020.
+
+// Command line compiler.
+// Loads saved projects without opening a window and writes each one out as an Erlang module.
+// Usage: alchemist-compile [-o OutputDirectory] [-j Jobs] Project.alch...
+
+#include "Libs.h"
+#include "Serialiser.h"
+
+#include "Module/Module.h"
+#include "Module/Function.h"
+#include "Nodes/Nodes.h"
+#include "Compiler/EmitSink.h"
+#include "Compiler/JobPool.h"
+#include "Compiler/Diagnostics.h"
+
+/** One project to compile, and what happened when it was. */
+struct CompileJob
+{
+	filesystem::path InputPath;
+	filesystem::path OutputPath;
+
+	/** The Erlang module name, taken from the input file. Empty if the file name can't be used as one. */
+	string ModuleName;
+
+	bool Ok = false;
+	string Report;
+};
+
+/**
+ * Makes a module name from a project file name, which is lowercased so it's an atom that doesn't need quoting.
+ * Returns an empty string if it still isn't one (i.e. it has a dash in it), as erlc needs the module name to match the .erl file's name.
+ */
+static string GetModuleName(const filesystem::path& InputPath)
+{
+	string Name = InputPath.stem().string();
+
+	for (char& Character : Name)
+	{
+		Character = (char)tolower((unsigned char)Character);
+	}
+
+	if (Name.empty() || Name[0] < 'a' || Name[0] > 'z')
+	{
+		return "";
+	}
+
+	for (char Character : Name)
+	{
+		if (!isalnum((unsigned char)Character) && Character != '_' && Character != '@')
+		{
+			return "";
+		}
+	}
+
+	return Name;
+}
+
+/** Writes every function in the module to an .erl file, with the module and export attributes in front. */
+static bool WriteModule(Module& CompiledModule, const filesystem::path& OutputPath, string& Report)
+{
+	const vector<shared_ptr<Function>>& Functions = CompiledModule.GetFunctions();
+	bool Ok = true;
+
+	for (const shared_ptr<Function>& Func : Functions)
+	{
+		Func->UpdateCache();
+
+		if (!Func->GetCachedPass())
+		{
+			Ok = false;
+		}
+	}
+
+	Diagnostics Problems;
+	Problems.Update(Functions);
+	Report += Problems.GetReport();
+
+	if (!Ok)
+	{
+		return false;
+	}
+
+	ofstream File(OutputPath, ios::binary);
+
+	if (!File)
+	{
+		Report += "Couldn't open " + OutputPath.string() + " for writing.\n";
+		return false;
+	}
+
+	{
+		// The sink flushes into the file as it fills up, so the whole module is never held in memory at once.
+		EmitSink Output(File);
+
+		Output += "-module(" + CompiledModule.GetName() + ").\n";
+		Output += "-export([";
+
+		for (int i = 0; i < Functions.size(); i++)
+		{
+			Output += (i > 0 ? ", " : "") + Functions[i]->GetName() + "/" + to_string(Functions[i]->GetArity());
+		}
+
+		Output += "]).\n\n";
+
+		for (const shared_ptr<Function>& Func : Functions)
+		{
+			Func->GetCachedCode().AppendTo(Output);
+			Output += "\n";
+		}
+	}
+
+	if (!File)
+	{
+		Report += "Couldn't write to " + OutputPath.string() + ".\n";
+		return false;
+	}
+
+	return true;
+}
+
+/** Loads and compiles one project. Jobs don't share anything, so any number of them can run at once. */
+static void RunJob(CompileJob& Job)
+{
+	if (Job.ModuleName.empty())
+	{
+		Job.Report = "Can't make a module name from " + Job.InputPath.filename().string() + ". Project names have to start with a letter, and can only have letters, digits, _ and @ in them.\n";
+		return;
+	}
+
+	Module JobModule(nullptr, Job.ModuleName);
+	NodeManager Nodes(&JobModule);
+
+	string Error;
+
+	if (!Serialiser::Load(JobModule, Nodes, Job.InputPath.string(), Error))
+	{
+		Job.Report = Error + "\n";
+		return;
+	}
+
+	Job.Ok = WriteModule(JobModule, Job.OutputPath, Job.Report);
+}
+
+static void PrintUsage()
+{
+	printf("Usage: alchemist-compile [-o OutputDirectory] [-j Jobs] Project.alch...\n");
+}
+
+int main(int argc, char* argv[])
+{
+	filesystem::path OutputDirectory;
+	int JobCount = JobPool::GetDefaultThreadCount() + 1;
+	vector<CompileJob> Jobs;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string Argument = argv[i];
+
+		if ((Argument == "-o" || Argument == "-j") && i + 1 < argc)
+		{
+			string Value = argv[++i];
+
+			if (Argument == "-o")
+			{
+				OutputDirectory = Value;
+			}
+			else
+			{
+				JobCount = max(1, atoi(Value.c_str()));
+			}
+		}
+		else if (Argument.size() > 0 && Argument[0] == '-')
+		{
+			PrintUsage();
+			return 1;
+		}
+		else
+		{
+			CompileJob Job;
+			Job.InputPath = Argument;
+			Jobs.push_back(move(Job));
+		}
+	}
+
+	if (Jobs.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	for (CompileJob& Job : Jobs)
+	{
+		filesystem::path Directory = OutputDirectory.empty() ? Job.InputPath.parent_path() : OutputDirectory;
+
+		Job.ModuleName = GetModuleName(Job.InputPath);
+		Job.OutputPath = Directory / (Job.ModuleName + ".erl");
+	}
+
+	if (!OutputDirectory.empty())
+	{
+		error_code Error;
+		filesystem::create_directories(OutputDirectory, Error);
+	}
+
+	// The calling thread takes jobs as well, so one less thread than the job count is needed.
+	JobPool Pool(JobCount - 1);
+
+	Pool.Run(Jobs.size(), [&Jobs](size_t Index)
+	{
+		RunJob(Jobs[Index]);
+	});
+
+	// Reports come out in the order the files were given, whichever finished first.
+	bool Ok = true;
+
+	for (const CompileJob& Job : Jobs)
+	{
+		printf("%s: %s\n", Job.InputPath.string().c_str(), Job.Ok ? ("wrote " + Job.OutputPath.string()).c_str() : "FAILED");
+		printf("%s", Job.Report.c_str());
+
+		Ok = Ok && Job.Ok;
+	}
+
+	return Ok ? 0 : 1;
+}